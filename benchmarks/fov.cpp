@@ -0,0 +1,69 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#include "dungeon.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Time per update_fov call and tiles seen, for every algorithm at ranges 8, 16, 32 and 64.
+// The viewer hops between floor tiles of a fixed level, so no call is served from the visibility cache.
+int main()
+{
+  using namespace roguey;
+  constexpr int side = 256, calls = 2000;
+
+  dungeon map(side, side);
+  std::mt19937 gen(42);
+  map.generate(gen);
+
+  std::vector<position> spots;
+  for (int y = 0; y < side; ++y)
+    for (int x = 0; x < side; ++x)
+      if (map.is_walkable(x, y)) spots.push_back({x, y});
+  std::shuffle(spots.begin(), spots.end(), gen);
+
+  struct algorithm
+  {
+    char const* name;
+    fov_algorithm kind;
+  };
+  constexpr algorithm algorithms[] = {{"raycast", fov_algorithm::Raycast},
+                                      {"shadowcast", fov_algorithm::Shadowcast},
+                                      {"symmetric", fov_algorithm::Symmetric}};
+
+  std::printf("%-6s %-11s %12s %12s\n", "range", "algorithm", "us/call", "tiles seen");
+  for (int range : {8, 16, 32, 64})
+    for (auto const& a : algorithms)
+    {
+      map.fov = a.kind;
+      long seen = 0;
+
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < calls; ++i)
+      {
+        auto p = spots[i % spots.size()];
+        map.update_fov(p.x, p.y, range);
+        seen += map.is_visible(p.x, p.y);
+      }
+      auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+      // Coverage is counted outside the timed loop
+      long tiles = 0;
+      for (int i = 0; i < 100; ++i)
+      {
+        auto p = spots[i % spots.size()];
+        map.update_fov(p.x, p.y, range);
+        tiles += static_cast<long>(map.visible_count());
+      }
+
+      std::printf("%-6d %-11s %12.2f %12.1f\n", range, a.name, elapsed / calls, tiles / 100.0);
+      if (seen != calls) std::printf("  viewer tile missing from its own field of view\n");
+    }
+}
@@ -7,28 +7,193 @@
 //==================================================================================================
 #pragma once
 #include "types.hpp"
+#include <array>
+#include <cstdint>
+#include <memory_resource>
 #include <random>
-#include <set>
+#include <span>
 #include <vector>
 
 namespace roguey
 {
+  // Symmetric is shadowcasting where floor tiles are only lit when their center is in view,
+  // so any two floor tiles either see each other or neither does
+  enum class fov_algorithm
+  {
+    Raycast,
+    Shadowcast,
+    Symmetric
+  };
+
+  struct sight_line
+  {
+    position from, to;
+  };
+
+  enum class level_generator
+  {
+    Rooms,
+    Caves
+  };
+
+  // Cells start as wall with probability fill, then every iteration turns a cell into wall when at least 5 of its
+  // 8 neighbours are walls, or 4 if it already is one. Only the largest open area is kept.
+  struct cave_settings
+  {
+    double fill = 0.45;
+    int iterations = 5;
+    // Side of the blocks the cave is cut into, each one with open ground gives a spawn spot in rooms
+    int spot_spacing = 12;
+  };
+
+  // Frozen state of a dungeon, grid bands are shared with the live map until either side writes to them
+  struct dungeon_snapshot
+  {
+    int width, height;
+    tile_registry tile_types;
+    chunked_grid<tile_id> tiles;
+    chunked_grid<std::uint8_t> flags;
+    chunked_bit_grid explored;
+    bit_grid visible;
+    position visible_origin;
+    std::pmr::vector<rectangle> rooms;
+    room_graph room_links;
+    std::vector<std::uint8_t> chunk_states;
+    std::vector<bool> chunk_seen;
+    std::vector<std::int32_t> chunk_first_room;
+    std::uint64_t seed;
+  };
+
   class dungeon
   {
   public:
     int width, height;
-    grid2D<char> grid;
-    grid2D<bool> explored;
-    std::set<position> visible_tiles;
-    std::vector<rectangle> rooms;
 
-    dungeon(int w, int h);
+    // Terrain is stored as tile ids into tile_types, with a parallel layer of their flags.
+    // The generator carves "floor" tiles out of "wall" tiles, levels may restyle both and add their own.
+    // Both layers are chunked: untouched areas read as wall and cost no memory.
+    tile_registry tile_types;
+    chunked_grid<tile_id> tiles;
+    chunked_grid<std::uint8_t> flags;
+
+    chunked_bit_grid explored;
+    std::pmr::vector<rectangle> rooms;
+    // Corridors between rooms as laid out by the generator, indexed like rooms. Caves have none and leave it empty.
+    room_graph room_links;
+    fov_algorithm fov = fov_algorithm::Shadowcast;
+
+    // Streaming levels are generated one chunk at a time around the player instead of all at once.
+    // Chunks are rebuilt identically from the level seed, so far ones are evicted unless they were edited.
+    // Their rooms are appended to rooms the first time a chunk is built.
+    level_generator generator = level_generator::Rooms;
+    cave_settings caves;
+
+    bool streaming = false;
+    int stream_radius = 2;
+    int evict_radius = 4;
+
+    // Reach of the flow field, monsters further away from the player than this get no direction
+    int flow_radius = 32;
+
+    dungeon(int w, int h, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    static tile_registry default_tiles(symbol wall_style = "asset_wall", symbol floor_style = "asset_floor");
+
     void generate(std::mt19937& gen);
+
+    // Whether room_links describes every room, so long paths can be planned across it
+    bool has_room_graph() const { return !rooms.empty() && room_links.size() == rooms.size(); }
+
+    // Build missing chunks near a position and evict far ones, does nothing on non streaming levels
+    void stream_around(position center);
+    std::size_t resident_chunks() const { return tiles.chunk_count(); }
+    // Visibility is cached on the viewer position, the range and the terrain revision,
+    // so calling this after an action that changed none of them is free
     void update_fov(int px, int py, int range);
     bool is_walkable(int x, int y) const;
+    bool has_flag(int x, int y, tile_flag flag) const { return flags(x, y) & flag; }
+    tile_type const& tile_at(int x, int y) const { return tile_types[tiles(x, y)]; }
+
+    // Walking distances to goal shared by every monster, only flooded again when goal or terrain changed
+    void update_flow(position goal);
+    // Step from (x, y) one tile closer to the flow goal, {0, 0} when there is none
+    position flow_step(int x, int y) const { return flow_.best_step(x, y); }
+    std::uint16_t flow_distance(int x, int y) const { return flow_.distance(x, y); }
+
+    // Terrain edits outside generate() go through set_tile so cached visibility is invalidated
+    void set_tile(int x, int y, tile_id tile);
+    std::uint64_t terrain_revision() const { return revision_; }
+
+    // Visibility only covers a window around the viewer, anything outside it is not visible
+    bool is_visible(int x, int y) const
+    {
+      unsigned vx = x - visible_origin_.x, vy = y - visible_origin_.y;
+      return vx < unsigned(visible_.width()) && vy < unsigned(visible_.height()) && visible_.test(vx, vy);
+    }
+
+    std::size_t visible_count() const { return visible_.count(); }
+
+    // One flag per line, set when no opaque tile lies strictly between its ends. Lines from a floor tile to the
+    // viewer of an up to date symmetric field of view are answered by it, the others are walked with Bresenham.
+    std::vector<bool> lines_of_sight(std::span<sight_line const> lines) const;
+
+    dungeon_snapshot take_snapshot() const;
+    void restore(dungeon_snapshot const& snapshot);
+
+    // Compact form of a freshly generated level: settings, tile types, rooms and tiles run-length encoded by row.
+    // Streaming levels only keep their seed, decoding rebuilds their first chunks from it.
+    void encode(byte_writer& out) const;
+    bool decode(byte_reader& in);
 
   private:
-    void carve_h(int x1, int x2, int y);
-    void carve_v(int y1, int y2, int x);
+    struct fov_cache
+    {
+      bool valid = false;
+      position origin;
+      int range;
+      fov_algorithm algorithm;
+      std::uint64_t revision;
+
+      // Shadowcasting keeps the tiles lit by each octant, the visible layer being their union.
+      // Octants whose wedge saw an opacity change since are the only ones cast again from the same view.
+      std::uint8_t dirty_octants = 0;
+      std::array<bit_grid, 8> octant_lit;
+    };
+
+    bool blocks_sight(int x, int y) const;
+    bool line_clear(position a, position b) const;
+    void raycast_fov(int px, int py, int range);
+    void shadowcast_fov(int px, int py, int range, std::uint8_t redo);
+
+    enum chunk_state : std::uint8_t
+    {
+      Absent,
+      Generated,
+      Pinned
+    };
+
+    void reset_layers();
+    void generate_rooms(std::mt19937& gen);
+    void generate_caves(std::mt19937& gen);
+    void generate_chunk(int cx, int cy);
+    void link_chunk(int cx, int cy, std::span<rectangle const> local);
+    void link_corridor(position from, position corner, position to, std::uint32_t first, std::uint32_t last);
+    void paint(int x, int y, tile_id tile);
+    void carve_h(int x1, int x2, int y, tile_id tile);
+    void carve_v(int y1, int y2, int x, tile_id tile);
+
+    bit_grid visible_;
+    position visible_origin_ = {0, 0};
+
+    std::vector<std::uint8_t> chunk_states_;
+    std::vector<bool> chunk_seen_;
+    // Index in rooms of the first room of each chunk, -1 when it has none or was never built
+    std::vector<std::int32_t> chunk_first_room_;
+    std::uint64_t seed_ = 0;
+
+    std::uint64_t revision_ = 0;
+    fov_cache fov_cache_;
+
+    distance_field flow_;
+    std::uint64_t flow_revision_ = 0;
   };
 }
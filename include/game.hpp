@@ -7,6 +7,7 @@
 //==================================================================================================
 #pragma once
 #include "dungeon.hpp"
+#include "level_builder.hpp"
 #include "registry.hpp"
 #include "renderer.hpp"
 #include "script_engine.hpp"
@@ -38,8 +39,15 @@ namespace roguey
     void set_menu_lock(int frames) { menu_lock = frames; }
 
     void reset(bool full_reset, std::string level_script = "");
+    // Keep the terrain around the player built on streaming levels, a no-op until the player moves
+    // Keep the terrain around the player built on streaming levels
+    void stream_level();
+
+    // Per-level allocations, released wholesale on reset(), so it must outlive everything using it
+    level_arena arena;
 
     dungeon map;
+    pathfinder paths{map};
     registry reg;
     renderer renderer;
     script_engine scripts;
@@ -53,6 +61,10 @@ namespace roguey
     // Level Management
     int depth = 1;
     std::string current_level_script;
+    // Hooks of current_level_script, set by reset()
+    compiled_script const* level_hooks = nullptr;
+    // Every floor of a run is derived from this seed and its depth, drawn again on a full reset
+    std::uint64_t run_seed = 0;
 
     // Input Control
     bool has_buffered_event = false;
@@ -62,12 +74,20 @@ namespace roguey
   private:
     void spawn_item(int x, int y, std::string script_path);
     bool spawn_monster(int x, int y, std::string script_path);
+    void instantiate_item(position at, std::string const& script_path, systems::item_data const& data);
+    entity_id instantiate_monster(position at, std::string const& script_path, systems::entity_data const& cfg);
+    void populate_rooms(std::size_t first, std::size_t last);
+    // Prototypes come from a prepared level when given, from running the scripts otherwise
+    void spawn_orders(std::span<spawn_order const> orders, prepared_level const* prepared = nullptr);
 
     bool debug_mode;
     bool running;
 
     state_machine machine;
 
+    // Next floor, built in the background while the current one is played
+    level_builder builder;
+
     std::random_device random_bits;
     std::mt19937 random_generator;
   };
@@ -0,0 +1,121 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include "dungeon.hpp"
+#include "script_engine.hpp"
+#include "systems.hpp"
+#include <cstdint>
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace roguey
+{
+  enum class spawn_kind
+  {
+    Monster,
+    Item
+  };
+
+  struct spawn_order
+  {
+    spawn_kind kind;
+    position at;
+    std::string script;
+  };
+
+  // Monsters and loot for the given rooms, drawn from the odds of a level script loaded by engine
+  std::vector<spawn_order> plan_spawns(script_engine& engine, compiled_script const& level,
+                                       std::span<rectangle const> rooms, int depth, std::mt19937& gen);
+
+  // A floor ready to be entered: terrain, spawn decisions and the entity prototypes they use.
+  // Everything in it is plain data, so it can be built away from the game and swapped in.
+  struct prepared_level
+  {
+    std::string script;
+    int depth = 0;
+    std::uint32_t seed = 0;
+    bool valid = false;
+
+    dungeon map{0, 0};
+    std::optional<spawn_order> boss;
+    std::vector<spawn_order> spawns;
+    std::map<std::string, systems::entity_data> monsters;
+    std::map<std::string, systems::item_data> items;
+
+    // Script errors met while building, replayed in the game log on entry
+    message_log log;
+  };
+
+  // Build a level from its own Lua state and random stream, safe to call from any thread
+  prepared_level build_level(std::string script, int depth, std::uint32_t seed);
+
+  // Seed of a floor, so a run replays identically from its seed alone
+  std::uint32_t floor_seed(std::uint64_t run_seed, int depth);
+
+  // Binary form of a valid prepared level, script errors are not kept
+  void encode_level(prepared_level const& level, byte_writer& out);
+  std::optional<prepared_level> decode_level(byte_reader& in);
+
+  // Encoded levels keyed by script, depth and seed, kept in memory only.
+  // Run seeds change with every new game, so the least recently used entry is dropped once capacity is reached.
+  class level_cache
+  {
+  public:
+    explicit level_cache(std::size_t capacity = 16) : capacity_(capacity) {}
+
+    std::optional<std::vector<std::uint8_t>> find(std::string const& script, int depth, std::uint32_t seed);
+    void store(std::string const& script, int depth, std::uint32_t seed, std::vector<std::uint8_t> bytes);
+
+  private:
+    using key = std::tuple<std::string, int, std::uint32_t>;
+
+    struct entry
+    {
+      std::vector<std::uint8_t> bytes;
+      std::uint64_t last_use;
+    };
+
+    std::mutex mutex_;
+    std::map<key, entry> entries_;
+    std::size_t capacity_;
+    std::uint64_t uses_ = 0;
+  };
+
+  // Builds the next floor on a worker thread while the current one is played
+  class level_builder
+  {
+  public:
+    ~level_builder();
+
+    // Decode the level from the cache, or build it and cache the result
+    prepared_level build(std::string const& script, int depth, std::uint32_t seed);
+
+    // Any level still being built is waited for and dropped
+    void start(std::string script, int depth, std::uint32_t seed);
+
+    // The level started for this script, depth and seed, if any, waiting for it to finish.
+    // Should the worker have thrown, the level is built again on the calling thread.
+    std::optional<prepared_level> take(std::string const& script, int depth, std::uint32_t seed);
+
+  private:
+    void discard();
+
+    level_cache cache_;
+    std::future<prepared_level> pending_;
+    std::string script_;
+    int depth_ = 0;
+    std::uint32_t seed_ = 0;
+  };
+}
@@ -0,0 +1,85 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include "dungeon.hpp"
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace roguey
+{
+  // A* with jump point search over the walkable tiles of a dungeon.
+  // Searches are bounded to the box around both ends grown by search_margin, node buffers are kept between
+  // queries and paths handed out through next_step are cached per requester until the terrain changes.
+  class pathfinder
+  {
+  public:
+    explicit pathfinder(dungeon const& map) : map_(&map) {}
+
+    int search_margin = 32;
+
+    // Tiles from start to goal, both included, or an empty path when the goal can't be reached.
+    // Diagonal steps never cut a wall corner.
+    std::vector<position> const& find(position start, position goal);
+
+    // Same path shape as find, planned across the room graph first and then searched one corridor at a time.
+    // Its cost follows the number of rooms rather than tiles, but the path may be longer than the shortest one.
+    std::vector<position> const& find_hierarchical(position start, position goal);
+
+    // find for goals within reach of a single bounded search, find_hierarchical beyond
+    std::vector<position> const& plan(position start, position goal);
+
+    // Offset of the next tile toward goal, {0, 0} when there is none
+    position next_step(entity_id requester, position start, position goal);
+
+    void clear_cache() { cache_.clear(); }
+
+    // Drop the path cached for a requester that left the level
+    void forget(entity_id requester) { cache_.erase(requester); }
+
+  private:
+    struct node
+    {
+      std::uint32_t stamp = 0;
+      std::uint32_t g;
+      std::uint32_t parent;
+      bool closed;
+    };
+
+    struct cached_path
+    {
+      position goal;
+      std::uint64_t revision;
+      std::vector<position> tiles;
+      std::size_t at;
+    };
+
+    bool walkable(int x, int y) const;
+    std::optional<std::uint32_t> room_near(position p) const;
+    bool route_rooms(std::uint32_t from, std::uint32_t to);
+    std::optional<position> jump(int x, int y, int dx, int dy) const;
+    void expand(std::uint32_t current);
+    void open(std::uint32_t parent, position to);
+    std::uint32_t local(position p) const { return (p.x - window_.x) + (p.y - window_.y) * window_.w; }
+    position global(std::uint32_t i) const { return {window_.x + int(i % window_.w), window_.y + int(i / window_.w)}; }
+
+    dungeon const* map_;
+    rectangle window_;
+    position goal_;
+    std::uint32_t search_ = 0;
+
+    std::vector<node> nodes_;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> heap_;
+    std::vector<position> path_;
+    std::vector<std::uint32_t> route_;
+    std::vector<position> waypoints_;
+    std::vector<position> long_path_;
+    std::unordered_map<entity_id, cached_path> cache_;
+  };
+}
@@ -7,7 +7,6 @@
 //==================================================================================================
 #pragma once
 #include "types.hpp"
-#include <map>
 #include <string>
 #include <vector>
 
@@ -16,7 +15,7 @@ namespace roguey
   struct renderable
   {
     char glyph;
-    std::string color;
+    symbol color;
   };
 
   struct projectile
@@ -25,32 +24,97 @@ namespace roguey
     int damage;
     int range;
     entity_id owner;
-    int action_delay = 2;
-    int action_timer = 0;
+  };
+
+  // Tag for entities queued for destruction at the next flush
+  struct pending_destroy
+  {
+  };
+
+  // Frozen state of a registry, sharing its storage chunks until either side writes to them
+  struct registry_snapshot
+  {
+    sparse_set<position>::storage positions;
+    sparse_set<renderable>::storage renderables;
+    sparse_set<stats>::storage stats;
+    sparse_set<item_tag>::storage items;
+    sparse_set<symbol>::storage names;
+    sparse_set<symbol>::storage script_paths;
+    sparse_set<symbol>::storage monster_types;
+    sparse_set<projectile>::storage projectiles;
+    timer_pool::storage timers;
+
+    cow_vector<std::uint32_t> generations;
+    cow_vector<std::uint32_t> free_indices;
+    int width = 0, height = 0;
+
+    entity_id player_id = 0;
+    entity_id boss_id = 0;
   };
 
   class registry
   {
   public:
-    std::map<entity_id, position> positions;
-    std::map<entity_id, renderable> renderables;
-    std::map<entity_id, stats> stats;
-    std::map<entity_id, item_tag> items;
-    std::map<entity_id, std::string> names;
-    std::map<entity_id, std::string> script_paths;
-    std::map<entity_id, std::string> monster_types;
-    std::map<entity_id, projectile> projectiles;
-
-    std::vector<entity_id> monsters;
+    // Pools signal the registry on structural changes, so it is pinned in memory
+    registry();
+    registry(registry const&) = delete;
+    registry& operator=(registry const&) = delete;
+
+    // The occupancy index follows position signals, so positions are written through place()
+    sparse_set<position> positions;
+    sparse_set<renderable> renderables;
+    sparse_set<stats> stats;
+    sparse_set<item_tag> items;
+    sparse_set<symbol> names;
+    sparse_set<symbol> script_paths;
+    sparse_set<symbol> monster_types;
+    sparse_set<projectile> projectiles;
+
+    // Action timers of monsters, projectiles and the player, counted down once per tick
+    timer_pool timers;
+
+    sparse_set<pending_destroy> pending_destroys;
+
+    spatial_index occupancy;
+
     entity_id player_id = 0;
+    // Kept once the boss dies: its handle failing alive() is the victory condition
     entity_id boss_id = 0;
-    entity_id next_id = 1;
     std::string player_name = "Hero";
     std::string player_class_script;
 
-    entity_id create_entity() { return next_id++; }
+    entity_id create_entity();
+
+    bool alive(entity_id id) const
+    {
+      auto index = entity_index(id);
+      return index != 0 && index < generations.size() && generations[index] == entity_generation(id);
+    }
 
     void clear();
     void destroy_entity(entity_id id);
+    void place(entity_id id, position p);
+
+    // Destructions requested while systems iterate are recorded and applied in one batch by flush().
+    // A deferred destroy takes the entity off the occupancy index right away so it stops blocking or being hit,
+    // and views can skip it by excluding pending_destroys.
+    void defer_destroy(entity_id id);
+    bool is_pending_destroy(entity_id id) const { return pending_destroys.contains(id); }
+    void flush();
+
+    // Snapshots are taken between events, once pending changes are flushed.
+    // Dropping a snapshot is just letting it go out of scope. Restoring emits no signals: the occupancy index is
+    // rebuilt from the positions, anything else derived from the pools is the caller's to refresh.
+    registry_snapshot take_snapshot() const;
+    void restore(registry_snapshot const& snapshot);
+
+  private:
+    void release(std::uint32_t index);
+    occupant occupant_kind(entity_id id) const;
+
+    // Slot 0 is reserved for the null handle.
+    // A slot generation is bumped when it is released, so every handle issued before is dead.
+    cow_vector<std::uint32_t> generations = cow_vector<std::uint32_t>(1, 0);
+    cow_vector<std::uint32_t> free_indices;
   };
 }
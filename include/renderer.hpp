@@ -12,7 +12,7 @@
 #include "systems.hpp"
 #include "types.hpp"
 #include <ftxui/dom/elements.hpp>
-#include <map>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -27,19 +27,18 @@ namespace roguey
 
     void load_config(sol::state& lua);
 
-    ftxui::Decorator get_style(std::string const& name) const;
+    ftxui::Decorator get_style(symbol name) const;
 
     ftxui::Element render_dungeon(dungeon const& map,
                                   registry const& reg,
                                   message_log const& log,
-                                  int player_id,
+                                  entity_id player_id,
                                   int depth,
-                                  std::string const& title,
-                                  std::string const& wall_color,
-                                  std::string const& floor_color);
+                                  std::string const& title);
 
     ftxui::Element render_inventory(std::vector<item_tag> const& inventory, message_log const& log);
-    ftxui::Element render_stats(registry const& reg, int player_id, std::string player_name, message_log const& log);
+    ftxui::Element render_stats(registry const& reg, entity_id player_id, std::string player_name,
+                                message_log const& log);
     ftxui::Element render_help(message_log const& log, std::string const& help_text);
 
     ftxui::Element render_character_creation(std::string const& current_name, message_log const& log);
@@ -52,7 +51,8 @@ namespace roguey
   private:
     ftxui::Element draw_log(message_log const& log);
 
-    std::map<std::string, theme_style> style_cache;
+    // Indexed by symbol id
+    std::vector<std::optional<theme_style>> style_cache;
     std::vector<SpeedThreshold> speed_thresholds; // Stores loaded speed config
 
     int last_cam_x = 0;
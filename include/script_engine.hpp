@@ -6,14 +6,28 @@
 */
 //==================================================================================================
 #pragma once
+#include "pathfinder.hpp"
 #include "registry.hpp"
 #include <random>
 #include <sol/sol.hpp>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace roguey
 {
+  struct message_log;
+
+  // Hooks of a script file, looked up once in its environment right after it ran.
+  // Those the script does not define hold nil.
+  struct compiled_script
+  {
+    sol::environment env;
+    sol::protected_function update_ai, update_projectile, get_init_stats, level_up, on_pick, on_use;
+    sol::protected_function get_level_config, get_next_level, get_spawn_odds, get_loot_odds, get_boss_script;
+    sol::table item_data, spell_data;
+  };
+
   class script_engine
   {
   public:
@@ -25,10 +39,24 @@ namespace roguey
     script_engine(std::string const& main_script);
 
     bool load_script(std::string const& path);
+
+    // Scripts are read, compiled and run the first time they are asked for, later calls hand back the same hooks
+    // without touching the file. A script that failed is reported once in log and stays null.
+    // Each one runs in its own environment: globals it defines stay private to it, and it reads the shared ones
+    // (colors, roll, Log, the engine functions) through a read-only view, so shared tables can't be modified either.
+    compiled_script const* script(symbol path, message_log& log);
     std::string pick_from_weights(sol::table weights, std::mt19937& gen);
 
+    // Level searched by find_path, scripts get no path while none is set
+    void set_pathfinder(pathfinder* paths) { paths_ = paths; }
+
   private:
+    pathfinder* paths_ = nullptr;
+    std::unordered_map<symbol, std::optional<compiled_script>> compiled_;
+    sol::table shared_globals_;
+
     void init_lua();
     void discover_assets();
+    void expose_style_keys();
   };
 }
@@ -14,18 +14,19 @@
 namespace roguey
 {
   class renderer;
+  class script_engine;
 
   struct message_log
   {
     struct entry
     {
       std::string text;
-      std::string color;
+      symbol color;
     };
 
     std::vector<entry> messages;
     size_t max_messages = 50;
-    void add(std::string msg, std::string const& color = "ui_default");
+    void add(std::string msg, symbol color = "ui_default");
   };
 
   namespace systems
@@ -34,27 +35,36 @@ namespace roguey
     struct entity_data
     {
       stats stats;
+      int delay;
       renderable render;
-      std::string name;
-      std::string type;
+      symbol name;
+      symbol type;
     };
 
-    std::optional<sol::table> try_get_table(sol::state& lua, std::string const& name, message_log& log);
+    struct item_data
+    {
+      renderable render;
+      item_type kind;
+      symbol name;
+    };
+
+    // A table a script was expected to define, logging its name when it did not
+    std::optional<sol::table> try_get_table(sol::table const& t, std::string const& name, message_log& log);
     entity_data parse_entity_config(sol::table const& t, std::string_view default_name = "Unknown");
+    item_data parse_item_config(sol::table const& t);
+    tile_registry parse_tile_config(sol::table const& level_config);
 
     std::string checked_script_path(std::string_view path);
 
     entity_id get_entity_at(registry const& reg, int x, int y, entity_id ignore_id = 0);
-    void attack(registry& reg, entity_id a_id, entity_id d_id, message_log& log, sol::state& lua);
-    void check_level_up(registry& reg, message_log& log, sol::state& lua);
-    void cast_fireball(registry& reg, dungeon& map, int dx, int dy, message_log& log, sol::state& lua);
+    void attack(registry& reg, entity_id a_id, entity_id d_id, message_log& log, script_engine& scripts);
+    void check_level_up(registry& reg, message_log& log, script_engine& scripts);
+    void cast_fireball(registry& reg, dungeon& map, int dx, int dy, message_log& log, script_engine& scripts);
 
     // Returns true if a visual change occurred (movement, damage, death)
-    bool update_projectiles(registry& reg, dungeon const& map, message_log& log, sol::state& lua);
+    bool update_projectiles(registry& reg, dungeon const& map, message_log& log, script_engine& scripts);
 
     // Returns true if a visual change occurred
-    bool move_monsters(registry& reg, dungeon const& map, message_log& log, sol::state& lua);
-
-    bool execute_script(sol::state& lua, std::string const& path, message_log& log);
+    bool move_monsters(registry& reg, dungeon const& map, message_log& log, script_engine& scripts);
   }
 }
@@ -6,9 +6,22 @@
 */
 //==================================================================================================
 #pragma once
+#include "types/bit_grid.hpp"
+#include "types/byte_stream.hpp"
+#include "types/chunked_bit_grid.hpp"
+#include "types/chunked_grid.hpp"
 #include "types/color.hpp"
+#include "types/distance_field.hpp"
 #include "types/entity.hpp"
 #include "types/game.hpp"
 #include "types/geometry.hpp"
 #include "types/grid.hpp"
 #include "types/items.hpp"
+#include "types/level_arena.hpp"
+#include "types/room_graph.hpp"
+#include "types/spatial_index.hpp"
+#include "types/symbol.hpp"
+#include "types/tiles.hpp"
+#include "types/timer_pool.hpp"
+#include "types/view.hpp"
+#include "types/sparse_set.hpp"
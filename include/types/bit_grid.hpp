@@ -0,0 +1,142 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace roguey
+{
+  // Grid of flags packed 64 to a word, each row starting on a word boundary.
+  // Single tile tests are a shift and a mask, rows are also exposed as words so scans and cellular rules handle
+  // 64 tiles per operation. An optional border of flags surrounds the grid, addressed with negative or past the end
+  // coordinates, so neighbour scans read it instead of checking bounds.
+  class bit_grid
+  {
+  public:
+    using word_type = std::uint64_t;
+    static constexpr int word_bits = 64;
+
+    bit_grid(int width = 0, int height = 0, int border = 0)
+        : width_(width), height_(height), border_(border), stride_((width + 2 * border + word_bits - 1) / word_bits),
+          words_(static_cast<std::size_t>(stride_) * (height + 2 * border), 0)
+    {
+    }
+
+    int width() const { return width_; }
+
+    int height() const { return height_; }
+
+    int border() const { return border_; }
+
+    bool test(int x, int y) const { return (words_[word(x, y)] >> ((x + border_) % word_bits)) & 1; }
+
+    void set(int x, int y) { words_[word(x, y)] |= word_type{1} << ((x + border_) % word_bits); }
+
+    void reset(int x, int y) { words_[word(x, y)] &= ~(word_type{1} << ((x + border_) % word_bits)); }
+
+    void clear() { std::fill(words_.begin(), words_.end(), 0); }
+
+    // Grids must have the same dimensions and border
+    bit_grid& operator|=(bit_grid const& other)
+    {
+      assert(width_ == other.width_ && height_ == other.height_ && border_ == other.border_);
+      for (std::size_t i = 0; i < words_.size(); ++i) words_[i] |= other.words_[i];
+      return *this;
+    }
+
+    // Number of set flags, border excluded
+    std::size_t count() const
+    {
+      std::size_t n = 0;
+      for (int y = 0; y < height_; ++y)
+        for (int x = 0; x < width_; x += word_bits)
+        {
+          auto w = bits(x, y);
+          if (width_ - x < word_bits) w &= (word_type{1} << (width_ - x)) - 1;
+          n += std::popcount(w);
+        }
+      return n;
+    }
+
+    // Words of row y, border included: bit i of the row is x = i - border()
+    std::span<word_type const> row_words(int y) const
+    {
+      return std::span<word_type const>(words_).subspan(static_cast<std::size_t>(y + border_) * stride_, stride_);
+    }
+
+    std::span<word_type> row_words(int y)
+    {
+      return std::span<word_type>(words_).subspan(static_cast<std::size_t>(y + border_) * stride_, stride_);
+    }
+
+    std::size_t words_per_row() const { return static_cast<std::size_t>(stride_); }
+
+    // Usually a value scans treat as a wall. Bits past the end of each row, which row_words writers may have set,
+    // are cleared.
+    void fill_border(bool sentinel)
+    {
+      int padded = width_ + 2 * border_;
+      for (int y = -border_; y < height_ + border_; ++y)
+      {
+        auto r = row_words(y);
+        if (y < 0 || y >= height_) fill_bits(r, 0, padded, sentinel);
+        else
+        {
+          fill_bits(r, 0, border_, sentinel);
+          fill_bits(r, border_ + width_, border_, sentinel);
+        }
+        fill_bits(r, padded, stride_ * word_bits - padded, false);
+      }
+    }
+
+    // The 64 flags of row y starting at x, bit i being (x + i, y). x needs no alignment, flags past the border are 0.
+    word_type bits(int x, int y) const
+    {
+      int p = x + border_;
+      if (y < -border_ || y >= height_ + border_ || p >= stride_ * word_bits || p <= -word_bits) return 0;
+      auto row = row_words(y);
+      if (p < 0) return row[0] << -p;
+
+      int w = p / word_bits, shift = p % word_bits;
+      word_type v = row[w] >> shift;
+      if (shift && w + 1 < stride_) v |= row[w + 1] << (word_bits - shift);
+      return v;
+    }
+
+  private:
+    std::size_t word(int x, int y) const
+    {
+      assert(x >= -border_ && x < width_ + border_ && y >= -border_ && y < height_ + border_);
+      return static_cast<std::size_t>(y + border_) * stride_ + (x + border_) / word_bits;
+    }
+
+    // n bits of a row starting at bit pos, one word at a time
+    static void fill_bits(std::span<word_type> r, int pos, int n, bool value)
+    {
+      for (; n > 0; ++pos, --n)
+      {
+        if (pos % word_bits == 0 && n >= word_bits)
+        {
+          r[pos / word_bits] = value ? ~word_type{0} : 0;
+          pos += word_bits - 1;
+          n -= word_bits - 1;
+        }
+        else if (value) r[pos / word_bits] |= word_type{1} << (pos % word_bits);
+        else r[pos / word_bits] &= ~(word_type{1} << (pos % word_bits));
+      }
+    }
+
+    int width_, height_, border_, stride_;
+    std::vector<word_type> words_;
+  };
+}
@@ -0,0 +1,98 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace roguey
+{
+  // Appends values to a byte buffer, integers as LEB128 varints so small values take a single byte
+  class byte_writer
+  {
+  public:
+    explicit byte_writer(std::vector<std::uint8_t>& bytes) : bytes_(bytes) {}
+
+    void put(std::uint64_t v)
+    {
+      while (v >= 0x80)
+      {
+        bytes_.push_back(static_cast<std::uint8_t>(v | 0x80));
+        v >>= 7;
+      }
+      bytes_.push_back(static_cast<std::uint8_t>(v));
+    }
+
+    // Signed values are zigzag encoded first so small negative values stay small
+    void put_int(std::int64_t v) { put((static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63)); }
+
+    void put_string(std::string_view s)
+    {
+      put(s.size());
+      bytes_.insert(bytes_.end(), s.begin(), s.end());
+    }
+
+  private:
+    std::vector<std::uint8_t>& bytes_;
+  };
+
+  // Reads back what byte_writer wrote. Running past the end or into a malformed value
+  // sets the reader in a failed state where every read yields zero.
+  class byte_reader
+  {
+  public:
+    explicit byte_reader(std::span<std::uint8_t const> bytes) : bytes_(bytes) {}
+
+    bool ok() const { return ok_; }
+
+    bool at_end() const { return offset_ == bytes_.size(); }
+
+    std::span<std::uint8_t const> remaining() const { return bytes_.subspan(offset_); }
+
+    std::uint64_t get()
+    {
+      std::uint64_t v = 0;
+      for (int shift = 0; ok_ && shift < 64; shift += 7)
+      {
+        if (offset_ == bytes_.size()) break;
+        std::uint8_t b = bytes_[offset_++];
+        v |= std::uint64_t{b & 0x7Fu} << shift;
+        if (!(b & 0x80)) return v;
+      }
+      ok_ = false;
+      return 0;
+    }
+
+    std::int64_t get_int()
+    {
+      std::uint64_t v = get();
+      return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+    }
+
+    std::string get_string()
+    {
+      std::uint64_t n = get();
+      if (!ok_ || n > bytes_.size() - offset_)
+      {
+        ok_ = false;
+        return {};
+      }
+      std::string s(reinterpret_cast<char const*>(bytes_.data() + offset_), n);
+      offset_ += n;
+      return s;
+    }
+
+  private:
+    std::span<std::uint8_t const> bytes_;
+    std::size_t offset_ = 0;
+    bool ok_ = true;
+  };
+}
@@ -0,0 +1,75 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace roguey
+{
+  // Sparse grid of flags in 64x64 chunks, one 64 bits word per chunk row.
+  // Chunks only exist once a flag is set in them, and are shared between copies until written to.
+  class chunked_bit_grid
+  {
+  public:
+    static constexpr int chunk_size = 64;
+
+    chunked_bit_grid(int width = 0, int height = 0)
+        : width_(width), height_(height), chunks_x_((width + chunk_size - 1) / chunk_size),
+          chunks_(static_cast<std::size_t>(chunks_x_) * ((height + chunk_size - 1) / chunk_size))
+    {
+    }
+
+    int width() const { return width_; }
+
+    int height() const { return height_; }
+
+    bool test(int x, int y) const
+    {
+      auto const& c = chunks_[directory(x, y)];
+      return c && (((*c)[y % chunk_size] >> (x % chunk_size)) & 1);
+    }
+
+    void set(int x, int y)
+    {
+      auto& c = chunks_[directory(x, y)];
+      if (!c) c = std::make_shared<chunk>();
+      else if (c.use_count() > 1) c = std::make_shared<chunk>(*c);
+      (*c)[y % chunk_size] |= std::uint64_t{1} << (x % chunk_size);
+    }
+
+    void clear() { chunks_.assign(chunks_.size(), nullptr); }
+
+    // Set the flags of bits in the chunk row holding (x, y), bit i being (x + i, y): x must start a chunk.
+    // Chunks are neither created nor copied when nothing new would be set.
+    void merge(int x, int y, std::uint64_t bits)
+    {
+      assert(x % chunk_size == 0);
+      auto& c = chunks_[directory(x, y)];
+      if (!bits || (c && ((*c)[y % chunk_size] | bits) == (*c)[y % chunk_size])) return;
+      if (!c) c = std::make_shared<chunk>();
+      else if (c.use_count() > 1) c = std::make_shared<chunk>(*c);
+      (*c)[y % chunk_size] |= bits;
+    }
+
+  private:
+    using chunk = std::array<std::uint64_t, chunk_size>;
+
+    std::size_t directory(int x, int y) const
+    {
+      assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+      return x / chunk_size + static_cast<std::size_t>(y / chunk_size) * chunks_x_;
+    }
+
+    int width_, height_, chunks_x_;
+    std::vector<std::shared_ptr<chunk>> chunks_;
+  };
+}
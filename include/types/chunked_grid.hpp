@@ -0,0 +1,102 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace roguey
+{
+  // Grid split in square chunks that only exist once written to.
+  // Reading a missing chunk yields the fill value, so memory follows the touched area rather than the nominal size.
+  // Chunks are shared between copies and duplicated on first write, copying a grid costs O(chunks).
+  // Reads never allocate: cells are only written through write(), which is where chunks are created or copied.
+  template<typename Element, int ChunkBits = 6> class chunked_grid
+  {
+  public:
+    static constexpr int chunk_size = 1 << ChunkBits;
+
+    chunked_grid(int width = 0, int height = 0, Element fill = {})
+        : width_(width), height_(height), chunks_x_((width + chunk_size - 1) >> ChunkBits),
+          chunks_y_((height + chunk_size - 1) >> ChunkBits), fill_(fill),
+          chunks_(static_cast<std::size_t>(chunks_x_) * chunks_y_)
+    {
+    }
+
+    int width() const { return width_; }
+
+    int height() const { return height_; }
+
+    int chunks_x() const { return chunks_x_; }
+
+    int chunks_y() const { return chunks_y_; }
+
+    // Value of cells in missing chunks
+    Element const& fill() const { return fill_; }
+
+    Element const& operator()(int x, int y) const
+    {
+      auto const& c = chunks_[directory(x, y)];
+      return c ? (*c)[offset(x, y)] : fill_;
+    }
+
+    // Allocates the chunk of the cell if missing, or copies it if shared
+    Element& write(int x, int y)
+    {
+      auto& c = chunks_[directory(x, y)];
+      if (!c) c = std::make_shared<chunk>(make_chunk());
+      else if (c.use_count() > 1) c = std::make_shared<chunk>(*c);
+      return (*c)[offset(x, y)];
+    }
+
+    bool has_chunk(int cx, int cy) const { return chunks_[cx + cy * chunks_x_] != nullptr; }
+
+    // The chunk reads as the fill value again
+    void drop_chunk(int cx, int cy) { chunks_[cx + cy * chunks_x_].reset(); }
+
+    // Drop every chunk, optionally changing the fill value
+    void clear() { chunks_.assign(chunks_.size(), nullptr); }
+
+    void clear(Element fill)
+    {
+      fill_ = fill;
+      clear();
+    }
+
+    std::size_t chunk_count() const
+    {
+      std::size_t n = 0;
+      for (auto const& c : chunks_) n += c != nullptr;
+      return n;
+    }
+
+  private:
+    using chunk = std::array<Element, chunk_size * chunk_size>;
+
+    chunk make_chunk() const
+    {
+      chunk c;
+      c.fill(fill_);
+      return c;
+    }
+
+    std::size_t directory(int x, int y) const
+    {
+      assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+      return (x >> ChunkBits) + (y >> ChunkBits) * static_cast<std::size_t>(chunks_x_);
+    }
+
+    static std::size_t offset(int x, int y) { return (x & (chunk_size - 1)) + ((y & (chunk_size - 1)) << ChunkBits); }
+
+    int width_, height_, chunks_x_, chunks_y_;
+    Element fill_;
+    std::vector<std::shared_ptr<chunk>> chunks_;
+  };
+}
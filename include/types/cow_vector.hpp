@@ -0,0 +1,121 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace roguey
+{
+  // Growable array stored as fixed-size chunks shared between copies.
+  // Copying only copies the chunk pointers; a chunk is duplicated the first time it is written to while shared,
+  // so a copy taken as a snapshot costs O(chunks) and only the chunks modified afterwards are ever cloned.
+  // Mutable access always goes through the non-const accessors, which perform the copy-on-write check.
+  template<typename T, std::size_t ChunkSize = 128> class cow_vector
+  {
+  public:
+    using value_type = T;
+
+    struct const_iterator
+    {
+      cow_vector const* owner;
+      std::size_t index;
+
+      T const& operator*() const { return (*owner)[index]; }
+
+      const_iterator& operator++()
+      {
+        ++index;
+        return *this;
+      }
+
+      bool operator==(const_iterator const& other) const { return index == other.index; }
+    };
+
+    cow_vector() = default;
+
+    cow_vector(std::size_t n, T const& value) { resize(n, value); }
+
+    std::size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    T const& operator[](std::size_t i) const
+    {
+      assert(i < size_);
+      return (*chunks_[i / ChunkSize])[i % ChunkSize];
+    }
+
+    T& operator[](std::size_t i)
+    {
+      assert(i < size_);
+      return writable(i / ChunkSize)[i % ChunkSize];
+    }
+
+    T const& back() const { return (*this)[size_ - 1]; }
+
+    T& back() { return (*this)[size_ - 1]; }
+
+    void push_back(T value)
+    {
+      if (size_ == chunks_.size() * ChunkSize) chunks_.push_back(std::make_shared<chunk>());
+      writable(size_ / ChunkSize)[size_ % ChunkSize] = std::move(value);
+      ++size_;
+    }
+
+    void pop_back()
+    {
+      assert(size_ > 0);
+      --size_;
+      if (size_ % ChunkSize == 0) chunks_.pop_back();
+      else writable(size_ / ChunkSize)[size_ % ChunkSize] = T{};
+    }
+
+    void resize(std::size_t n, T const& value = T{})
+    {
+      while (size_ > n) pop_back();
+      while (size_ < n) push_back(value);
+    }
+
+    void clear()
+    {
+      chunks_.clear();
+      size_ = 0;
+    }
+
+    std::size_t chunk_count() const { return chunks_.size(); }
+
+    // Live elements of chunk c, contiguous in memory, for loops working a chunk at a time
+    std::span<T const> chunk_span(std::size_t c) const { return {chunks_[c]->data(), chunk_length(c)}; }
+
+    std::span<T> chunk_span(std::size_t c) { return {writable(c).data(), chunk_length(c)}; }
+
+    const_iterator begin() const { return {this, 0}; }
+
+    const_iterator end() const { return {this, size_}; }
+
+  private:
+    using chunk = std::array<T, ChunkSize>;
+
+    std::size_t chunk_length(std::size_t c) const { return std::min(ChunkSize, size_ - c * ChunkSize); }
+
+    chunk& writable(std::size_t c)
+    {
+      if (chunks_[c].use_count() > 1) chunks_[c] = std::make_shared<chunk>(*chunks_[c]);
+      return *chunks_[c];
+    }
+
+    std::vector<std::shared_ptr<chunk>> chunks_;
+    std::size_t size_ = 0;
+  };
+}
@@ -0,0 +1,97 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include "types/geometry.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace roguey
+{
+  // Step counts to a goal over 8-connected tiles, flooded breadth first within a square window around it.
+  // One flood serves every walker: each of them descends the field one neighbour at a time.
+  class distance_field
+  {
+  public:
+    static constexpr std::uint16_t unreachable = 0xFFFF;
+
+    position goal() const { return goal_; }
+
+    int radius() const { return radius_; }
+
+    template<typename Passable> void compute(position goal, int radius, Passable&& passable)
+    {
+      goal_ = goal;
+      radius_ = radius;
+      origin_ = {goal.x - radius, goal.y - radius};
+      side_ = 2 * radius + 1;
+      distances_.assign(static_cast<std::size_t>(side_) * side_, unreachable);
+
+      // Frontier tiles are stored as window indices, the queue is the flat array itself
+      queue_.clear();
+      distances_[index(goal.x, goal.y)] = 0;
+      queue_.push_back(static_cast<std::uint32_t>(index(goal.x, goal.y)));
+
+      for (std::size_t head = 0; head < queue_.size(); ++head)
+      {
+        int wx = queue_[head] % side_, wy = queue_[head] / side_;
+        std::uint16_t next = distances_[queue_[head]] + 1;
+
+        for (auto [dx, dy] : neighbours)
+        {
+          int nx = wx + dx, ny = wy + dy;
+          if (nx < 0 || ny < 0 || nx >= side_ || ny >= side_) continue;
+
+          auto i = static_cast<std::size_t>(nx + ny * side_);
+          if (distances_[i] != unreachable || !passable(origin_.x + nx, origin_.y + ny)) continue;
+          distances_[i] = next;
+          queue_.push_back(static_cast<std::uint32_t>(i));
+        }
+      }
+    }
+
+    std::uint16_t distance(int x, int y) const { return inside(x, y) ? distances_[index(x, y)] : unreachable; }
+
+    // Offset of the neighbour of (x, y) closest to the goal, {0, 0} when none gets closer.
+    // The tile itself does not have to be passable, so walkers standing on the goal's blockers still find a way.
+    position best_step(int x, int y) const
+    {
+      position best = {0, 0};
+      std::uint16_t best_distance = distance(x, y);
+      for (auto [dx, dy] : neighbours)
+      {
+        std::uint16_t d = distance(x + dx, y + dy);
+        if (d < best_distance)
+        {
+          best_distance = d;
+          best = {dx, dy};
+        }
+      }
+      return best;
+    }
+
+  private:
+    // Orthogonal steps first, so ties resolve to the straight move
+    static constexpr position neighbours[] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {-1, 1}, {1, -1}, {-1, -1}};
+
+    bool inside(int x, int y) const
+    {
+      return unsigned(x - origin_.x) < unsigned(side_) && unsigned(y - origin_.y) < unsigned(side_);
+    }
+
+    std::size_t index(int x, int y) const
+    {
+      return static_cast<std::size_t>((x - origin_.x) + (y - origin_.y) * side_);
+    }
+
+    position goal_ = {0, 0}, origin_ = {0, 0};
+    int radius_ = 0, side_ = 0;
+    std::vector<std::uint16_t> distances_;
+    std::vector<std::uint32_t> queue_;
+  };
+}
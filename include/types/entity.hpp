@@ -6,17 +6,33 @@
 */
 //==================================================================================================
 #pragma once
+#include "types/symbol.hpp"
 #include <cstdint>
-#include <string>
 
 namespace roguey
 {
+  // Entity handles pack a recyclable slot index (low bits) with the generation of that slot (high bits).
+  // Index 0 is never handed out so a null handle stays 0.
   using entity_id = std::uint64_t;
 
+  constexpr std::uint32_t entity_index(entity_id id)
+  {
+    return static_cast<std::uint32_t>(id);
+  }
+
+  constexpr std::uint32_t entity_generation(entity_id id)
+  {
+    return static_cast<std::uint32_t>(id >> 32);
+  }
+
+  constexpr entity_id make_entity(std::uint32_t index, std::uint32_t generation)
+  {
+    return (static_cast<entity_id>(generation) << 32) | index;
+  }
+
   struct stats
   {
-    std::string archetype;
+    symbol archetype;
     int hp, max_hp, mana, max_mana, damage, xp, level, fov_range, gold;
-    int action_delay, action_timer;
   };
 }
@@ -6,6 +6,8 @@
 */
 //==================================================================================================
 #pragma once
+#include "types/symbol.hpp"
+#include <string>
 
 namespace roguey
 {
@@ -24,7 +26,7 @@ namespace roguey
   {
     int limit;
     std::string label;
-    std::string color;
+    symbol color;
   };
 
 }
@@ -6,29 +6,88 @@
 */
 //==================================================================================================
 #pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace roguey
 {
-  template<typename Element> struct grid2D : private std::vector<Element>
+  // Row-major grid stored as bands of rows shared between copies.
+  // Copying a grid only copies the band pointers; a band is duplicated the first time it is written to while
+  // shared, so a copy kept as a snapshot costs O(bands) and rows stay contiguous within a band.
+  template<typename Element> class grid2D
   {
+    static_assert(!std::is_same_v<Element, bool>, "flags are packed in bit_grid");
+
   public:
-    using data_type = std::vector<Element>;
+    static constexpr int band_rows = 16;
+
+    grid2D(int width = 0, int height = 0, Element value = {}) : width_(width), height_(height) { fill(value); }
+
+    int width() const { return width_; }
+
+    int height() const { return height_; }
+
+    std::size_t size() const { return static_cast<std::size_t>(width_) * height_; }
+
+    bool empty() const { return size() == 0; }
 
-    grid2D(int width, int height, Element value = {}) : data_type(width * height, value), width_(width), height_(height)
+    Element const& operator()(int x, int y) const
     {
+      auto [b, i] = locate(x, y);
+      return (*bands_[b])[i];
     }
 
-    using data_type::begin;
-    using data_type::empty;
-    using data_type::end;
-    using data_type::size;
+    Element& operator()(int x, int y)
+    {
+      auto [b, i] = locate(x, y);
+      return writable(b)[i];
+    }
+
+    std::span<Element const> row(int y) const
+    {
+      auto [b, i] = locate(0, y);
+      return std::span<Element const>(*bands_[b]).subspan(i, width_);
+    }
 
-    decltype(auto) operator()(int x, int y) const { return data_type::operator[](x + y * width_); }
+    std::span<Element> row(int y)
+    {
+      auto [b, i] = locate(0, y);
+      return std::span<Element>(writable(b)).subspan(i, width_);
+    }
 
-    decltype(auto) operator()(int x, int y) { return data_type::operator[](x + y * width_); }
+    // Reset every cell, dropping any band shared with another grid without copying it
+    void fill(Element value)
+    {
+      bands_.clear();
+      for (int y = 0; y < height_; y += band_rows)
+      {
+        auto rows = std::min(band_rows, height_ - y);
+        bands_.push_back(std::make_shared<band>(static_cast<std::size_t>(rows) * width_, value));
+      }
+    }
 
   private:
+    using band = std::vector<Element>;
+
+    // Band and offset of a cell
+    std::pair<std::size_t, std::size_t> locate(int x, int y) const
+    {
+      return {static_cast<std::size_t>(y / band_rows),
+              static_cast<std::size_t>(x) + static_cast<std::size_t>(y % band_rows) * width_};
+    }
+
+    band& writable(std::size_t b)
+    {
+      if (bands_[b].use_count() > 1) bands_[b] = std::make_shared<band>(*bands_[b]);
+      return *bands_[b];
+    }
+
     int width_, height_;
+    std::vector<std::shared_ptr<band>> bands_;
   };
 }
@@ -6,7 +6,7 @@
 */
 //==================================================================================================
 #pragma once
-#include <string>
+#include "types/symbol.hpp"
 
 namespace roguey
 {
@@ -21,7 +21,7 @@ namespace roguey
   {
     item_type type;
     int value;
-    std::string name;
-    std::string script;
+    symbol name;
+    symbol script;
   };
 }
@@ -0,0 +1,57 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+
+namespace roguey
+{
+  // Monotonic memory resource for data living exactly as long as a level.
+  // Deallocation is a no-op, everything is handed back at once by release().
+  // The next level starts with a single upstream block sized after the largest level seen so far,
+  // so a long session does not keep growing and fragmenting the heap one level at a time.
+  class level_arena : public std::pmr::memory_resource
+  {
+  public:
+    explicit level_arena(std::size_t initial_size = 16 * 1024) { buffer_.emplace(initial_size); }
+
+    level_arena(level_arena const&) = delete;
+    level_arena& operator=(level_arena const&) = delete;
+
+    // Every container allocating from the arena must have dropped its storage before this is called
+    void release()
+    {
+      buffer_.emplace(std::max(high_water_, std::size_t{1024}));
+      used_ = 0;
+    }
+
+    // Bytes handed out since the last release
+    std::size_t used() const { return used_; }
+
+    // Largest number of bytes a single level ever used
+    std::size_t high_water() const { return high_water_; }
+
+  private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+      used_ += bytes;
+      high_water_ = std::max(high_water_, used_);
+      return buffer_->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+
+    std::optional<std::pmr::monotonic_buffer_resource> buffer_;
+    std::size_t used_ = 0;
+    std::size_t high_water_ = 0;
+  };
+}
@@ -0,0 +1,48 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include "types/geometry.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace roguey
+{
+  // Which rooms of a level are joined by a corridor. Every corridor bends at most once per room it joins,
+  // through its via tile, so walking center to via to center follows it.
+  class room_graph
+  {
+  public:
+    struct link
+    {
+      std::uint32_t to;
+      position via;
+    };
+
+    std::size_t size() const { return links_.size(); }
+
+    void resize(std::size_t rooms) { links_.resize(rooms); }
+
+    void clear() { links_.clear(); }
+
+    // Rooms already linked keep their first corridor
+    void connect(std::uint32_t a, std::uint32_t b, position via)
+    {
+      for (auto const& l : links_[a])
+        if (l.to == b) return;
+      links_[a].push_back({b, via});
+      links_[b].push_back({a, via});
+    }
+
+    std::span<link const> links(std::uint32_t room) const { return links_[room]; }
+
+  private:
+    std::vector<std::vector<link>> links_;
+  };
+}
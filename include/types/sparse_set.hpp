@@ -0,0 +1,230 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include "types/cow_vector.hpp"
+#include "types/entity.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace roguey
+{
+  // Component pool storing values contiguously.
+  // dense ids and values are kept in lockstep, sparse maps an entity to its slot in the dense arrays.
+  // Removal swaps the last element in the hole so storage stays packed.
+  //
+  // Pools emit signals when a component is constructed, updated through replace()/patch() or destroyed.
+  // Destruction is signaled before the value is removed so listeners can still read it.
+  // Writes through operator[] or at() are not observed.
+  //
+  // All three arrays are copy-on-write chunked storage, so snapshot() is O(chunks) and a restored pool only
+  // clones the chunks written to afterwards.
+  template<typename Component> class sparse_set
+  {
+  public:
+    using value_type = Component;
+    using listener = std::function<void(entity_id)>;
+
+    template<bool IsConst> struct basic_iterator
+    {
+      using owner_type = std::conditional_t<IsConst, sparse_set const, sparse_set>;
+      using reference = std::pair<entity_id, std::conditional_t<IsConst, Component const&, Component&>>;
+
+      owner_type* owner;
+      std::size_t index;
+
+      reference operator*() const { return {owner->dense_[index], owner->values_[index]}; }
+
+      basic_iterator& operator++()
+      {
+        ++index;
+        return *this;
+      }
+
+      bool operator==(basic_iterator const& other) const { return index == other.index; }
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    struct storage
+    {
+      cow_vector<std::uint32_t> sparse;
+      cow_vector<entity_id> dense;
+      cow_vector<Component> values;
+    };
+
+    bool contains(entity_id id) const
+    {
+      auto s = slot(id);
+      return s < sparse_.size() && sparse_[s] < dense_.size() && dense_[sparse_[s]] == id;
+    }
+
+    // Same semantic as std::map::count, kept for call sites written against maps
+    std::size_t count(entity_id id) const { return contains(id) ? 1 : 0; }
+
+    Component& at(entity_id id)
+    {
+      assert(contains(id));
+      return values_[sparse_[slot(id)]];
+    }
+
+    Component const& at(entity_id id) const
+    {
+      assert(contains(id));
+      return values_[sparse_[slot(id)]];
+    }
+
+    // Default-construct the component if the entity does not have one yet
+    Component& operator[](entity_id id)
+    {
+      if (contains(id)) return values_[sparse_[slot(id)]];
+      return emplace(id);
+    }
+
+    template<typename... Args> Component& emplace(entity_id id, Args&&... args)
+    {
+      assert(!contains(id));
+      auto s = slot(id);
+      if (s >= sparse_.size()) sparse_.resize(s + 1, npos);
+
+      sparse_[s] = static_cast<std::uint32_t>(dense_.size());
+      dense_.push_back(id);
+      values_.push_back(Component{std::forward<Args>(args)...});
+      notify(on_construct_, id);
+      return values_[sparse_[s]];
+    }
+
+    Component& replace(entity_id id, Component value)
+    {
+      return patch(id, [&](Component& c) { c = std::move(value); });
+    }
+
+    // Modify a component in place and signal the update
+    template<typename Callable> Component& patch(entity_id id, Callable f)
+    {
+      f(at(id));
+      notify(on_update_, id);
+      return at(id);
+    }
+
+    void erase(entity_id id)
+    {
+      if (!contains(id)) return;
+      notify(on_destroy_, id);
+
+      auto hole = sparse_[slot(id)];
+      auto last = dense_.size() - 1;
+      if (hole != last)
+      {
+        dense_[hole] = dense_[last];
+        values_[hole] = std::move(values_[last]);
+        sparse_[slot(dense_[hole])] = hole;
+      }
+
+      dense_.pop_back();
+      values_.pop_back();
+      sparse_[slot(id)] = npos;
+    }
+
+    // Keep the sparse index allocation around, only the live entries are dropped
+    void clear()
+    {
+      if (!on_destroy_.empty() || tracking_)
+      {
+        for (auto id : dense_) notify(on_destroy_, id);
+      }
+
+      for (auto id : dense_) sparse_[slot(id)] = npos;
+      dense_.clear();
+      values_.clear();
+    }
+
+    std::size_t size() const { return dense_.size(); }
+
+    bool empty() const { return dense_.empty(); }
+
+    cow_vector<entity_id> const& ids() const { return dense_; }
+
+    iterator begin() { return {this, 0}; }
+
+    iterator end() { return {this, dense_.size()}; }
+
+    const_iterator begin() const { return {this, 0}; }
+
+    const_iterator end() const { return {this, dense_.size()}; }
+
+    void on_construct(listener f) { on_construct_.push_back(std::move(f)); }
+
+    void on_update(listener f) { on_update_.push_back(std::move(f)); }
+
+    void on_destroy(listener f) { on_destroy_.push_back(std::move(f)); }
+
+    // Optional change tracking: every entity whose component was constructed, updated or destroyed since the
+    // last clear_changes() is recorded once, so incremental systems only revisit what moved.
+    void track_changes(bool enabled)
+    {
+      tracking_ = enabled;
+      clear_changes();
+    }
+
+    std::span<entity_id const> changes() const { return changed_; }
+
+    void clear_changes()
+    {
+      for (auto id : changed_) changed_marks_[slot(id)] = 0;
+      changed_.clear();
+    }
+
+    storage snapshot() const { return {sparse_, dense_, values_}; }
+
+    // Restoring does not emit signals: owners rebuild whatever state they derive from the pool
+    void restore(storage const& data)
+    {
+      sparse_ = data.sparse;
+      dense_ = data.dense;
+      values_ = data.values;
+      clear_changes();
+    }
+
+  private:
+    static constexpr std::uint32_t npos = ~std::uint32_t{0};
+
+    void notify(std::vector<listener> const& listeners, entity_id id)
+    {
+      if (tracking_)
+      {
+        auto s = slot(id);
+        if (s >= changed_marks_.size()) changed_marks_.resize(s + 1, 0);
+        if (changed_marks_[s] != id)
+        {
+          changed_marks_[s] = id;
+          changed_.push_back(id);
+        }
+      }
+
+      for (auto const& f : listeners) f(id);
+    }
+
+    static std::size_t slot(entity_id id) { return entity_index(id); }
+
+    cow_vector<std::uint32_t> sparse_;
+    cow_vector<entity_id> dense_;
+    cow_vector<Component> values_;
+
+    std::vector<listener> on_construct_, on_update_, on_destroy_;
+
+    bool tracking_ = false;
+    std::vector<entity_id> changed_;
+    std::vector<entity_id> changed_marks_;
+  };
+}
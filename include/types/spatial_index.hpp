@@ -0,0 +1,176 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include "types/entity.hpp"
+#include "types/geometry.hpp"
+#include "types/chunked_grid.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace roguey
+{
+  enum class occupant : std::uint8_t
+  {
+    Other,
+    Blocker,
+    Pickup
+  };
+
+  // Per-tile occupancy grid, chunked so only populated areas use memory.
+  // Each tile holds the head of an intrusive doubly linked list of the entities standing on it,
+  // so moving or removing an entity is O(1) and a point query only walks the tile occupants.
+  class spatial_index
+  {
+  public:
+    spatial_index() : heads_(0, 0, npos) {}
+
+    void resize(int width, int height)
+    {
+      width_ = width;
+      height_ = height;
+      heads_ = chunked_grid<std::uint32_t>(width, height, npos);
+      nodes_.clear();
+    }
+
+    void clear()
+    {
+      heads_.clear();
+      nodes_.clear();
+    }
+
+    int width() const { return width_; }
+
+    int height() const { return height_; }
+
+    bool in_bounds(int x, int y) const { return x >= 0 && x < width_ && y >= 0 && y < height_; }
+
+    void insert(entity_id id, position p, occupant kind)
+    {
+      auto s = slot(id);
+      if (s >= nodes_.size()) nodes_.resize(s + 1);
+
+      auto& n = nodes_[s];
+      if (n.id) unlink(s);
+      n.id = id;
+      n.kind = kind;
+      n.pos = p;
+      link(s);
+    }
+
+    void move(entity_id id, position p)
+    {
+      auto s = slot(id);
+      if (s >= nodes_.size() || nodes_[s].id != id) return;
+      if (nodes_[s].pos == p) return;
+
+      unlink(s);
+      nodes_[s].pos = p;
+      link(s);
+    }
+
+    void set_kind(entity_id id, occupant kind)
+    {
+      auto s = slot(id);
+      if (s < nodes_.size() && nodes_[s].id == id) nodes_[s].kind = kind;
+    }
+
+    void remove(entity_id id)
+    {
+      auto s = slot(id);
+      if (s >= nodes_.size() || nodes_[s].id != id) return;
+
+      unlink(s);
+      nodes_[s] = {};
+    }
+
+    // Blockers win over any other occupant, mirroring how movement and attacks resolve a tile
+    entity_id at(int x, int y, entity_id ignore_id = 0) const
+    {
+      entity_id found = 0;
+      for_each_at(x, y, [&](entity_id id, occupant kind) {
+        if (id == ignore_id) return true;
+        if (kind == occupant::Blocker)
+        {
+          found = id;
+          return false;
+        }
+        if (!found) found = id;
+        return true;
+      });
+      return found;
+    }
+
+    bool is_blocked(int x, int y) const
+    {
+      bool blocked = false;
+      for_each_at(x, y, [&](entity_id, occupant kind) { return !(blocked = (kind == occupant::Blocker)); });
+      return blocked;
+    }
+
+    // Callback returns false to stop the walk
+    template<typename Callable> void for_each_at(int x, int y, Callable f) const
+    {
+      if (!in_bounds(x, y)) return;
+      for (auto s = heads_(x, y); s != npos; s = nodes_[s].next)
+      {
+        if (!f(nodes_[s].id, nodes_[s].kind)) return;
+      }
+    }
+
+    template<typename Callable> void query(rectangle const& area, Callable f) const
+    {
+      int x0 = std::max(area.x, 0), x1 = std::min(area.x + area.w, width_);
+      int y0 = std::max(area.y, 0), y1 = std::min(area.y + area.h, height_);
+
+      for (int y = y0; y < y1; ++y)
+        for (int x = x0; x < x1; ++x)
+          for (auto s = heads_(x, y); s != npos; s = nodes_[s].next) f(nodes_[s].id, nodes_[s].pos, nodes_[s].kind);
+    }
+
+  private:
+    static constexpr std::uint32_t npos = ~std::uint32_t{0};
+
+    struct node
+    {
+      entity_id id = 0;
+      position pos = {-1, -1};
+      std::uint32_t prev = npos, next = npos;
+      occupant kind = occupant::Other;
+    };
+
+    static std::size_t slot(entity_id id) { return entity_index(id); }
+
+    void link(std::size_t s)
+    {
+      auto& n = nodes_[s];
+      n.prev = n.next = npos;
+      if (!in_bounds(n.pos.x, n.pos.y)) return;
+
+      auto& head = heads_.write(n.pos.x, n.pos.y);
+      n.next = head;
+      if (head != npos) nodes_[head].prev = static_cast<std::uint32_t>(s);
+      head = static_cast<std::uint32_t>(s);
+    }
+
+    void unlink(std::size_t s)
+    {
+      auto& n = nodes_[s];
+      if (!in_bounds(n.pos.x, n.pos.y)) return;
+
+      if (n.prev != npos) nodes_[n.prev].next = n.next;
+      else heads_.write(n.pos.x, n.pos.y) = n.next;
+      if (n.next != npos) nodes_[n.next].prev = n.prev;
+      n.prev = n.next = npos;
+    }
+
+    int width_ = 0, height_ = 0;
+    chunked_grid<std::uint32_t> heads_;
+    std::vector<node> nodes_;
+  };
+}
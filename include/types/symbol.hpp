@@ -0,0 +1,46 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace roguey
+{
+  // Handle to a string stored once in the global interner.
+  // Equal strings share the same id, so copies, comparisons and lookups are integer operations.
+  // The default symbol is the empty string.
+  class symbol
+  {
+  public:
+    symbol() = default;
+    symbol(char const* s) : symbol(std::string_view{s}) {}
+    symbol(std::string const& s) : symbol(std::string_view{s}) {}
+    symbol(std::string_view s);
+
+    std::string const& str() const;
+    std::uint32_t id() const { return id_; }
+    bool empty() const { return id_ == 0; }
+
+    // Number of distinct strings interned so far, usable to size symbol-indexed tables
+    static std::size_t count();
+
+    auto operator<=>(symbol const&) const = default;
+
+  private:
+    std::uint32_t id_ = 0;
+  };
+}
+
+template<> struct std::hash<roguey::symbol>
+{
+  std::size_t operator()(roguey::symbol s) const noexcept { return s.id(); }
+};
@@ -0,0 +1,68 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include "types/symbol.hpp"
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace roguey
+{
+  using tile_id = std::uint8_t;
+
+  // Terrain properties, packed so a grid of them answers movement and sight queries with a single mask
+  enum tile_flag : std::uint8_t
+  {
+    Walkable = 1 << 0,
+    Opaque = 1 << 1,
+    Explorable = 1 << 2,
+    Damaging = 1 << 3
+  };
+
+  struct tile_type
+  {
+    symbol name;
+    char glyph;
+    symbol style;
+    std::uint8_t flags;
+  };
+
+  // Tile types of a level, addressed by their compact id
+  class tile_registry
+  {
+  public:
+    // Redefining a name keeps its id
+    tile_id add(tile_type type)
+    {
+      if (auto id = find(type.name))
+      {
+        types_[*id] = type;
+        return *id;
+      }
+
+      assert(types_.size() < 256);
+      types_.push_back(type);
+      return static_cast<tile_id>(types_.size() - 1);
+    }
+
+    std::optional<tile_id> find(symbol name) const
+    {
+      for (std::size_t i = 0; i < types_.size(); ++i)
+        if (types_[i].name == name) return static_cast<tile_id>(i);
+      return std::nullopt;
+    }
+
+    tile_type const& operator[](tile_id id) const { return types_[id]; }
+
+    std::size_t size() const { return types_.size(); }
+
+  private:
+    std::vector<tile_type> types_;
+  };
+}
@@ -0,0 +1,172 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include "types/cow_vector.hpp"
+#include "types/entity.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace roguey
+{
+  // Action timers stored as structure of arrays.
+  // Remaining ticks and delays live in their own dense arrays, in lockstep with the entity ids,
+  // so the per-tick countdown streams over plain integers instead of visiting whole components.
+  class timer_pool
+  {
+  public:
+    struct storage
+    {
+      cow_vector<std::uint32_t> sparse;
+      cow_vector<entity_id> dense;
+      cow_vector<int> remaining;
+      cow_vector<int> delay;
+    };
+
+    bool contains(entity_id id) const
+    {
+      auto s = entity_index(id);
+      return s < sparse_.size() && sparse_[s] < dense_.size() && dense_[sparse_[s]] == id;
+    }
+
+    void emplace(entity_id id, int delay, int remaining = 0)
+    {
+      assert(!contains(id));
+      auto s = entity_index(id);
+      if (s >= sparse_.size()) sparse_.resize(s + 1, npos);
+
+      sparse_[s] = static_cast<std::uint32_t>(dense_.size());
+      dense_.push_back(id);
+      remaining_.push_back(remaining);
+      delay_.push_back(delay);
+    }
+
+    void erase(entity_id id)
+    {
+      if (!contains(id)) return;
+
+      auto hole = sparse_[entity_index(id)];
+      auto last = dense_.size() - 1;
+      if (hole != last)
+      {
+        dense_[hole] = dense_[last];
+        remaining_[hole] = remaining_[last];
+        delay_[hole] = delay_[last];
+        sparse_[entity_index(dense_[hole])] = hole;
+      }
+
+      dense_.pop_back();
+      remaining_.pop_back();
+      delay_.pop_back();
+      sparse_[entity_index(id)] = npos;
+    }
+
+    void clear()
+    {
+      for (auto id : dense_) sparse_[entity_index(id)] = npos;
+      dense_.clear();
+      remaining_.clear();
+      delay_.clear();
+      ready_.clear();
+    }
+
+    std::size_t size() const { return dense_.size(); }
+
+    bool empty() const { return dense_.empty(); }
+
+    int remaining(entity_id id) const { return remaining_[index_of(id)]; }
+
+    int delay(entity_id id) const { return delay_[index_of(id)]; }
+
+    // Entities without a timer never wait
+    bool expired(entity_id id) const { return !contains(id) || remaining(id) == 0; }
+
+    void set_delay(entity_id id, int delay) { delay_[index_of(id)] = delay; }
+
+    // Start a new wait after the entity acted
+    void rearm(entity_id id)
+    {
+      auto i = index_of(id);
+      remaining_[i] = delay_[i];
+    }
+
+    // One tick for every timer: the ids of timers that were already expired make up the ready list,
+    // every other timer is decremented. Expired timers stay at zero until their owner acts and rearms them.
+    //
+    // Works a chunk at a time with branch-free loops that compile to vector code.
+    // A reduction finds the chunks holding an expired timer and only those are scanned for ids,
+    // so idle entities only cost a few lanes of the decrement.
+    void countdown()
+    {
+      ready_.clear();
+      for (std::size_t c = 0; c < remaining_.chunk_count(); ++c)
+      {
+        auto timers = remaining_.chunk_span(c);
+
+        int expired = 0;
+        for (auto t : timers) expired += (t == 0);
+
+        if (expired != 0)
+        {
+          auto ids = std::as_const(dense_).chunk_span(c);
+          for (std::size_t i = 0; i < timers.size(); ++i)
+            if (timers[i] == 0) ready_.push_back(ids[i]);
+        }
+
+        for (auto& t : timers) t -= (t > 0);
+      }
+    }
+
+    // Same as countdown() for the given ids only, so some timers can keep running while the others are paused.
+    // The ready list then only holds those ids.
+    template<typename Ids> void countdown_of(Ids const& ids)
+    {
+      ready_.clear();
+      for (auto id : ids)
+      {
+        if (!contains(id)) continue;
+        auto& t = remaining_[index_of(id)];
+        if (t == 0) ready_.push_back(id);
+        else --t;
+      }
+    }
+
+    // Entities whose timer was expired at the last countdown() or countdown_of()
+    std::span<entity_id const> ready() const { return ready_; }
+
+    storage snapshot() const { return {sparse_, dense_, remaining_, delay_}; }
+
+    void restore(storage const& data)
+    {
+      sparse_ = data.sparse;
+      dense_ = data.dense;
+      remaining_ = data.remaining;
+      delay_ = data.delay;
+      ready_.clear();
+    }
+
+  private:
+    static constexpr std::uint32_t npos = ~std::uint32_t{0};
+
+    std::size_t index_of(entity_id id) const
+    {
+      assert(contains(id));
+      return sparse_[entity_index(id)];
+    }
+
+    cow_vector<std::uint32_t> sparse_;
+    cow_vector<entity_id> dense_;
+    cow_vector<int> remaining_;
+    cow_vector<int> delay_;
+
+    std::vector<entity_id> ready_;
+  };
+}
@@ -0,0 +1,110 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#pragma once
+#include "types/cow_vector.hpp"
+#include "types/entity.hpp"
+#include <cstddef>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace roguey
+{
+  template<typename Included, typename Excluded = std::tuple<>> class basic_view;
+
+  // Join over several component pools.
+  // Iteration walks the ids of the smallest included pool and probes every other pool for membership,
+  // so the cost is driven by the rarest component rather than by the whole registry.
+  template<typename... Included, typename... Excluded>
+  class basic_view<std::tuple<Included...>, std::tuple<Excluded...>>
+  {
+  public:
+    explicit basic_view(std::tuple<Included&...> included, std::tuple<Excluded&...> excluded = {})
+        : included_(included), excluded_(excluded)
+    {
+    }
+
+    // Filter out entities owning a component from any of the given pools
+    template<typename... Others> auto exclude(Others&... others) const
+    {
+      return basic_view<std::tuple<Included...>, std::tuple<Excluded..., Others...>>(
+        included_, std::tuple_cat(excluded_, std::tuple<Others&...>(others...)));
+    }
+
+    bool contains(entity_id id) const
+    {
+      return std::apply([id](auto&... p) { return (p.contains(id) && ...); }, included_) &&
+             !std::apply([id](auto&... p) { return (p.contains(id) || ...); }, excluded_);
+    }
+
+    std::size_t size_hint() const { return ids_of(leading()).size(); }
+
+    // Calls f(id, components...) for every matching entity.
+    // Entities are visited from the back of the leading pool so removing the current entity is safe.
+    // If f returns a bool, returning false stops the iteration.
+    template<typename Callable> void each(Callable f) const
+    {
+      auto lead = leading();
+      for (auto i = ids_of(lead).size(); i-- > 0;)
+      {
+        auto const& ids = ids_of(lead);
+        if (i >= ids.size()) continue;
+
+        auto id = ids[i];
+        if (contains(id) && !invoke(f, id)) return;
+      }
+    }
+
+    // Same as each(f) but only visits the given ids, in order, for systems driven by an external work list
+    template<typename Ids, typename Callable> void each_of(Ids const& ids, Callable f) const
+    {
+      for (auto id : ids)
+        if (contains(id) && !invoke(f, id)) return;
+    }
+
+  private:
+    template<typename Callable> bool invoke(Callable& f, entity_id id) const
+    {
+      auto call = [&](auto&... p) { return f(id, p.at(id)...); };
+      if constexpr (std::is_same_v<decltype(std::apply(call, included_)), bool>) return std::apply(call, included_);
+      else
+      {
+        std::apply(call, included_);
+        return true;
+      }
+    }
+
+    // Index of the smallest included pool
+    std::size_t leading() const
+    {
+      std::size_t best = 0, k = 0;
+      auto best_size = std::numeric_limits<std::size_t>::max();
+      std::apply([&](auto&... p) { ((p.size() < best_size ? (best = k, best_size = p.size()) : 0, ++k), ...); },
+                 included_);
+      return best;
+    }
+
+    cow_vector<entity_id> const& ids_of(std::size_t which) const
+    {
+      return *[&]<std::size_t... I>(std::index_sequence<I...>) {
+        cow_vector<entity_id> const* ids = nullptr;
+        ((which == I ? (ids = &std::get<I>(included_).ids(), 0) : 0), ...);
+        return ids;
+      }(std::index_sequence_for<Included...>{});
+    }
+
+    std::tuple<Included&...> included_;
+    std::tuple<Excluded&...> excluded_;
+  };
+
+  template<typename... Pools> auto view(Pools&... pools)
+  {
+    return basic_view<std::tuple<Pools...>>(std::tuple<Pools&...>(pools...));
+  }
+}
@@ -9,8 +9,13 @@ function get_level_config(depth)
         name = "Deep Dungeon",
         width = 120,
         height = 40,
-        wall_color = asset_wall,
-        floor_color = asset_floor,
+        tiles = {
+            wall  = { glyph = "#", color = asset_wall,  opaque = true },
+            floor = { glyph = ".", color = asset_floor, walkable = true }
+        },
+        fov = "symmetric",  -- or "shadowcast", "raycast": symmetric lets monsters reuse it to spot the player
+        streaming = false,  -- build the map in chunks around the player, for very large levels
+        generator = { kind = "rooms" }, -- or "caves", see forest.lua
         is_boss_level = (depth % 3 == 0)
     }
 end
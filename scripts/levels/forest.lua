@@ -9,8 +9,14 @@ function get_level_config(depth)
         name = "Whispering Woods",
         width = 80,
         height = 20,
-        wall_color = asset_tree,
-        floor_color = asset_dirt,
+        tiles = {
+            wall  = { glyph = "T", color = asset_tree,  opaque = true },
+            floor = { glyph = ".", color = asset_dirt, walkable = true }
+        },
+        fov = "shadowcast", -- or "raycast", "symmetric"
+        streaming = false,  -- build the map in chunks around the player, for very large levels
+        -- open woodland grown by a cellular automaton instead of rooms and corridors, never streamed
+        generator = { kind = "caves", fill = 0.45, iterations = 5, spot_spacing = 12 },
         is_boss_level = (depth % 5 == 0)
     }
 end
@@ -19,6 +25,10 @@ function get_next_level(depth)
     return "scripts/levels/dungeon.lua"
 end
 
+function get_boss_script(depth)
+    return "scripts/monsters/boss.lua"
+end
+
 function get_spawn_odds(depth)
     return { ["scripts/monsters/slime.lua"] = 100 }
 end
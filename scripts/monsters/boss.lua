@@ -14,9 +14,12 @@ function get_init_stats()
     }
 end
 
-function update_ai(mx, my, px, py)
-    -- entity_boss always moves towards player
-    local dx = (px > mx) and 1 or (px < mx and -1 or 0)
-    local dy = (py > my) and 1 or (py < my and -1 or 0)
+function update_ai(mx, my, px, py, id, can_see)
+    -- The boss plans a full path to the player and keeps following it while the way stays open
+    local dx, dy = find_path(mx, my, px, py, id)
+    if dx ~= 0 or dy ~= 0 or not can_see then return dx, dy end
+
+    dx = (px > mx) and 1 or (px < mx and -1 or 0)
+    dy = (py > my) and 1 or (py < my and -1 or 0)
     return dx, dy
 end
@@ -15,8 +15,12 @@ function get_init_stats()
     }
 end
 
-function update_ai(mx, my, px, py)
-    local dx = (px > mx) and 1 or (px < mx and -1 or 0)
-    local dy = (py > my) and 1 or (py < my and -1 or 0)
+function update_ai(mx, my, px, py, id, can_see)
+    -- Follow the shared flow field around walls, charge straight in when out of its reach but in sight
+    local dx, dy = flow_step(mx, my)
+    if dx ~= 0 or dy ~= 0 or not can_see then return dx, dy end
+
+    dx = (px > mx) and 1 or (px < mx and -1 or 0)
+    dy = (py > my) and 1 or (py < my and -1 or 0)
     return dx, dy
-end
\ No newline at end of file
+end
@@ -14,9 +14,10 @@ function get_init_stats()
     }
 end
 
-function update_ai(mx, my, px, py)
+function update_ai(mx, my, px, py, id, can_see)
     local dx, dy = 0, 0
-    -- Simple greedy pathfinding towards the player
+    -- Slimes only notice the player in plain sight, then crawl straight at them
+    if not can_see then return dx, dy end
     if mx < px then dx = 1 elseif mx > px then dx = -1 end
     if my < py then dy = 1 elseif my > py then dy = -1 end
 
@@ -8,19 +8,58 @@
 
 #include "dungeon.hpp"
 #include <algorithm>
+#include <bit>
 #include <cmath>
+#include <optional>
 #include <random>
+#include <utility>
 
 namespace roguey
 {
-  dungeon::dungeon(int w, int h) : width(w), height(h), grid(w, h, '#'), explored(w, h, false) {}
+  tile_registry dungeon::default_tiles(symbol wall_style, symbol floor_style)
+  {
+    tile_registry types;
+    types.add({"wall", '#', wall_style, Opaque | Explorable});
+    types.add({"floor", '.', floor_style, Walkable | Explorable});
+    return types;
+  }
+
+  dungeon::dungeon(int w, int h, std::pmr::memory_resource* resource)
+      : width(w), height(h), tile_types(default_tiles()), rooms(resource)
+  {
+    reset_layers();
+  }
+
+  void dungeon::reset_layers()
+  {
+    tile_id wall = tile_types.find("wall").value_or(0);
+    tiles = chunked_grid<tile_id>(width, height, wall);
+    flags = chunked_grid<std::uint8_t>(width, height, tile_types[wall].flags);
+    explored = chunked_bit_grid(width, height);
+    visible_ = bit_grid();
+    chunk_states_.assign(static_cast<std::size_t>(tiles.chunks_x()) * tiles.chunks_y(), Absent);
+    chunk_seen_.assign(chunk_states_.size(), false);
+    chunk_first_room_.assign(chunk_states_.size(), -1);
+    rooms.clear();
+    room_links.clear();
+    ++revision_;
+    fov_cache_.valid = false;
+  }
 
   void dungeon::generate(std::mt19937& gen)
   {
+    reset_layers();
+    seed_ = (std::uint64_t{gen()} << 32) | gen();
+
+    if (generator == level_generator::Caves) generate_caves(gen);
+    else if (streaming) stream_around({width / 2, height / 2});
+    else generate_rooms(gen);
+  }
+
+  void dungeon::generate_rooms(std::mt19937& gen)
+  {
+    tile_id floor = tile_types.find("floor").value_or(0);
     std::uniform_int_distribution<> dis_w(6, 12), dis_h(4, 7), dis_x(1, width - 13), dis_y(1, height - 8);
-    rooms.clear();
-    grid = grid2D(width, height, '#');
-    explored = grid2D(width, height, false);
 
     for (int i = 0; i < 50; ++i)
     {
@@ -28,44 +67,661 @@ namespace roguey
       if (std::none_of(rooms.begin(), rooms.end(), [&](rectangle const& r) { return room.intersects(r); }))
       {
         for (int y = room.y; y < room.y + room.h; ++y)
-          for (int x = room.x; x < room.x + room.w; ++x) grid(x, y) = '.';
-        if (!rooms.empty())
+          for (int x = room.x; x < room.x + room.w; ++x) paint(x, y, floor);
+        rooms.push_back(room);
+        room_links.resize(rooms.size());
+        if (rooms.size() > 1)
         {
-          position p1 = rooms.back().center(), p2 = room.center();
+          position p1 = rooms[rooms.size() - 2].center(), p2 = room.center();
+          auto count = static_cast<std::uint32_t>(rooms.size());
           if (gen() % 2)
           {
-            carve_h(p1.x, p2.x, p1.y);
-            carve_v(p1.y, p2.y, p2.x);
+            carve_h(p1.x, p2.x, p1.y, floor);
+            carve_v(p1.y, p2.y, p2.x, floor);
+            link_corridor(p1, {p2.x, p1.y}, p2, 0, count);
           }
           else
           {
-            carve_v(p1.y, p2.y, p1.x);
-            carve_h(p1.x, p2.x, p2.y);
+            carve_v(p1.y, p2.y, p1.x, floor);
+            carve_h(p1.x, p2.x, p2.y, floor);
+            link_corridor(p1, {p1.x, p2.y}, p2, 0, count);
           }
         }
-        rooms.push_back(room);
       }
     }
+
+    // Nothing to rebuild, the whole level is resident for good
+    std::fill(chunk_states_.begin(), chunk_states_.end(), Pinned);
+  }
+
+  namespace
+  {
+    using cave_bits = bit_grid;
+    using cave_word = cave_bits::word_type;
+
+    // Bits set with probability p to 1/256: each random word pulls the result toward 1 or 0 following one bit of p,
+    // from the least significant one up
+    void random_fill(cave_bits& walls, double p, std::mt19937& gen)
+    {
+      auto threshold = static_cast<unsigned>(std::clamp(p, 0.0, 1.0) * 256);
+      for (int y = 0; y < walls.height(); ++y)
+        for (auto& w : walls.row_words(y))
+        {
+          cave_word x = threshold >= 256 ? ~cave_word{0} : 0;
+          for (int i = 0; i < 8 && threshold < 256; ++i)
+          {
+            cave_word r = (cave_word{gen()} << 32) | gen();
+            x = (threshold >> i) & 1 ? (x | r) : (x & r);
+          }
+          w = x;
+        }
+      walls.fill_border(true);
+    }
+
+    cave_word full_add(cave_word x, cave_word y, cave_word z, cave_word& carry)
+    {
+      cave_word s = x ^ y;
+      carry = (x & y) | (s & z);
+      return s ^ z;
+    }
+
+    // The 4-5 rule for 64 cells at once. The eight neighbour words are summed into bit planes with a carry save
+    // adder tree, then compared against the thresholds with plain logic: no per cell count is ever built.
+    cave_word cave_rule(cave_word a, cave_word b, cave_word c, cave_word d, cave_word e, cave_word f, cave_word g,
+                        cave_word h, cave_word self)
+    {
+      cave_word c0, c1, c3, c4;
+      cave_word s0 = full_add(a, b, c, c0), s1 = full_add(d, e, f, c1);
+      cave_word s2 = g ^ h, c2 = g & h;
+      cave_word ones = full_add(s0, s1, s2, c3);
+      cave_word t = full_add(c0, c1, c2, c4);
+      cave_word twos = t ^ c3, c5 = t & c3;
+      cave_word fours = c4 ^ c5, eights = c4 & c5;
+      return eights | (fours & (twos | ones | self));
+    }
+
+    // Rows carry a one cell wall border, so shifting words in from their neighbours is all the edge handling needed.
+    // The inner loop is branch free over contiguous words and vectorizes.
+    void smooth(cave_bits const& from, cave_bits& to)
+    {
+      auto n = from.words_per_row();
+      for (int y = 0; y < from.height(); ++y)
+      {
+        auto up = from.row_words(y - 1), mid = from.row_words(y), down = from.row_words(y + 1);
+        auto out = to.row_words(y);
+
+        auto step = [&](std::size_t i, cave_word before, cave_word after) {
+          auto west = [&](std::span<cave_word const> r, cave_word prev) { return (r[i] << 1) | (prev >> 63); };
+          auto east = [&](std::span<cave_word const> r, cave_word next) { return (r[i] >> 1) | (next << 63); };
+          out[i] = cave_rule(west(up, before ? up[i - 1] : 0), up[i], east(up, after ? up[i + 1] : 0),
+                             west(mid, before ? mid[i - 1] : 0), east(mid, after ? mid[i + 1] : 0),
+                             west(down, before ? down[i - 1] : 0), down[i], east(down, after ? down[i + 1] : 0),
+                             mid[i]);
+        };
+
+        if (n == 1)
+        {
+          step(0, 0, 0);
+          continue;
+        }
+
+        step(0, 0, 1);
+        for (std::size_t i = 1; i + 1 < n; ++i)
+        {
+          out[i] = cave_rule((up[i] << 1) | (up[i - 1] >> 63), up[i], (up[i] >> 1) | (up[i + 1] << 63),
+                             (mid[i] << 1) | (mid[i - 1] >> 63), (mid[i] >> 1) | (mid[i + 1] << 63),
+                             (down[i] << 1) | (down[i - 1] >> 63), down[i], (down[i] >> 1) | (down[i + 1] << 63),
+                             mid[i]);
+        }
+        step(n - 1, 1, 0);
+      }
+      to.fill_border(true);
+    }
+
+    // Only the largest 4-connected open area is kept, so every floor tile can be reached without cutting corners.
+    // Areas are labelled over a padded copy where walls and the border hold a sentinel, so the flood moves by index
+    // offsets alone, then every tile outside the largest area becomes wall again.
+    void keep_largest_cave(cave_bits& walls)
+    {
+      constexpr std::uint32_t wall = 0xFFFFFFFF;
+      int w = walls.width(), h = walls.height();
+      std::ptrdiff_t stride = w + 2;
+      std::vector<std::uint32_t> area(static_cast<std::size_t>(stride) * (h + 2), wall), queue;
+      auto at = [&](int x, int y) { return static_cast<std::size_t>((x + 1) + (y + 1) * stride); };
+
+      for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+          if (!walls.test(x, y)) area[at(x, y)] = 0;
+
+      std::uint32_t areas = 0, best = 0;
+      std::size_t best_size = 0;
+      std::ptrdiff_t const offsets[] = {1, -1, stride, -stride};
+
+      for (std::size_t start = 0; start < area.size(); ++start)
+      {
+        if (area[start]) continue;
+
+        area[start] = ++areas;
+        queue.assign(1, static_cast<std::uint32_t>(start));
+        for (std::size_t head = 0; head < queue.size(); ++head)
+          for (auto o : offsets)
+          {
+            auto i = static_cast<std::size_t>(queue[head] + o);
+            if (area[i]) continue;
+            area[i] = areas;
+            queue.push_back(static_cast<std::uint32_t>(i));
+          }
+
+        if (queue.size() > best_size)
+        {
+          best_size = queue.size();
+          best = areas;
+        }
+      }
+
+      for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+          if (area[at(x, y)] != best) walls.set(x, y);
+    }
+  }
+
+  // Caves are built whole, there are no chunks to stream. They have no corridors either, so no room graph:
+  // rooms only hold spawn spots, one per block of open ground in scan order, and long paths use the flat search.
+  void dungeon::generate_caves(std::mt19937& gen)
+  {
+    streaming = false;
+    tile_id floor = tile_types.find("floor").value_or(0);
+
+    cave_bits walls(width, height, 1), next(width, height, 1);
+    random_fill(walls, caves.fill, gen);
+    for (int i = 0; i < caves.iterations; ++i)
+    {
+      smooth(walls, next);
+      std::swap(walls, next);
+    }
+    keep_largest_cave(walls);
+
+    for (int y = 0; y < height; ++y)
+      for (int x = 0; x < width; ++x)
+        if (!walls.test(x, y)) paint(x, y, floor);
+
+    int spacing = std::max(2, caves.spot_spacing);
+    for (int by = 0; by < height; by += spacing)
+      for (int bx = 0; bx < width; bx += spacing)
+      {
+        std::optional<position> spot;
+        int best = 0;
+        position mid = {bx + spacing / 2, by + spacing / 2};
+        for (int y = by; y < std::min(by + spacing, height); ++y)
+          for (int x = bx; x < std::min(bx + spacing, width); ++x)
+          {
+            int d = std::abs(x - mid.x) + std::abs(y - mid.y);
+            if (walls.test(x, y) || (spot && d >= best)) continue;
+            spot = position{x, y};
+            best = d;
+          }
+        if (spot) rooms.push_back({spot->x, spot->y, 1, 1});
+      }
+
+    std::fill(chunk_states_.begin(), chunk_states_.end(), Pinned);
+  }
+
+  // Rooms of a chunk are laid out from a generator seeded by the level seed and the chunk coordinates only,
+  // so a chunk comes back identical after eviction. The first room is joined to the middle of every inner
+  // chunk edge, and neighbours open on the same tiles, which keeps the whole level connected.
+  void dungeon::generate_chunk(int cx, int cy)
+  {
+    constexpr int size = chunked_grid<tile_id>::chunk_size;
+    tile_id floor = tile_types.find("floor").value_or(0);
+
+    std::seed_seq seq{std::uint32_t(seed_), std::uint32_t(seed_ >> 32), std::uint32_t(cx), std::uint32_t(cy)};
+    std::mt19937 gen(seq);
+
+    int x0 = cx * size, y0 = cy * size;
+    int x1 = std::min(x0 + size, width) - 1, y1 = std::min(y0 + size, height) - 1;
+
+    // Chunks are too small for rooms near the border of the map, those stay solid
+    std::vector<rectangle> local;
+    if (x1 - x0 >= 16 && y1 - y0 >= 12)
+    {
+      std::uniform_int_distribution<> dis_w(6, 12), dis_h(4, 7), dis_x(x0 + 1, x1 - 13), dis_y(y0 + 1, y1 - 8);
+      for (int i = 0; i < 8; ++i)
+      {
+        rectangle room{dis_x(gen), dis_y(gen), dis_w(gen), dis_h(gen)};
+        if (std::any_of(local.begin(), local.end(), [&](rectangle const& r) { return room.intersects(r); })) continue;
+
+        for (int y = room.y; y < room.y + room.h; ++y)
+          for (int x = room.x; x < room.x + room.w; ++x) paint(x, y, floor);
+        if (!local.empty())
+        {
+          position p1 = local.back().center(), p2 = room.center();
+          carve_h(p1.x, p2.x, p1.y, floor);
+          carve_v(p1.y, p2.y, p2.x, floor);
+        }
+        local.push_back(room);
+      }
+    }
+
+    if (!local.empty())
+    {
+      position c = local.front().center();
+      int mx = x0 + size / 2, my = y0 + size / 2;
+      if (cy > 0 && mx <= x1)
+      {
+        carve_h(c.x, mx, c.y, floor);
+        carve_v(c.y, y0, mx, floor);
+      }
+      if (y1 + 1 < height && mx <= x1)
+      {
+        carve_h(c.x, mx, c.y, floor);
+        carve_v(c.y, y1, mx, floor);
+      }
+      if (cx > 0 && my <= y1)
+      {
+        carve_v(c.y, my, c.x, floor);
+        carve_h(c.x, x0, my, floor);
+      }
+      if (x1 + 1 < width && my <= y1)
+      {
+        carve_v(c.y, my, c.x, floor);
+        carve_h(c.x, x1, my, floor);
+      }
+    }
+
+    auto index = static_cast<std::size_t>(cx + cy * tiles.chunks_x());
+    chunk_states_[index] = Generated;
+    if (!chunk_seen_[index] && !local.empty()) link_chunk(cx, cy, local);
+    chunk_seen_[index] = true;
+  }
+
+  // Corridors often cut through other rooms on their way, each room they cross is linked to the next one met.
+  // The via tile is the corner when it lies between the two rooms, the middle of the stretch joining them otherwise.
+  void dungeon::link_corridor(position from, position corner, position to, std::uint32_t first, std::uint32_t last)
+  {
+    auto room_at = [&](position p) -> std::int64_t {
+      for (std::uint32_t i = first; i < last; ++i)
+      {
+        auto const& r = rooms[i];
+        if (p.x >= r.x && p.y >= r.y && p.x < r.x + r.w && p.y < r.y + r.h) return i;
+      }
+      return -1;
+    };
+
+    // Both legs are straight, stepping each coordinate toward the target walks them
+    auto toward = [](position p, position t) {
+      return position{p.x + (t.x > p.x) - (t.x < p.x), p.y + (t.y > p.y) - (t.y < p.y)};
+    };
+
+    std::vector<position> path;
+    for (position p = from; !(p == corner); p = toward(p, corner)) path.push_back(p);
+    std::size_t bend = path.size();
+    for (position p = corner; !(p == to); p = toward(p, to)) path.push_back(p);
+    path.push_back(to);
+
+    std::int64_t previous = -1;
+    std::size_t exit = 0;
+    for (std::size_t k = 0; k < path.size(); ++k)
+    {
+      auto room = room_at(path[k]);
+      if (room < 0) continue;
+      if (previous >= 0 && room != previous)
+      {
+        position via = exit <= bend && bend <= k ? corner : path[(exit + k) / 2];
+        room_links.connect(static_cast<std::uint32_t>(previous), static_cast<std::uint32_t>(room), via);
+      }
+      previous = room;
+      exit = k;
+    }
+  }
+
+  // Rooms of a chunk follow each other in the room graph, and its first room joins the first room of every
+  // neighbour built so far through the middle of their shared edge, where both corridors meet.
+  void dungeon::link_chunk(int cx, int cy, std::span<rectangle const> local)
+  {
+    constexpr int size = chunked_grid<tile_id>::chunk_size;
+    auto first = static_cast<std::uint32_t>(rooms.size());
+    rooms.insert(rooms.end(), local.begin(), local.end());
+    room_links.resize(rooms.size());
+
+    auto last = static_cast<std::uint32_t>(rooms.size());
+    for (std::uint32_t i = 1; i < local.size(); ++i)
+    {
+      position p1 = local[i - 1].center(), p2 = local[i].center();
+      link_corridor(p1, {p2.x, p1.y}, p2, first, last);
+    }
+
+    chunk_first_room_[cx + cy * tiles.chunks_x()] = static_cast<std::int32_t>(first);
+
+    int x0 = cx * size, y0 = cy * size;
+    auto join = [&](int nx, int ny, position via) {
+      if (nx < 0 || ny < 0 || nx >= tiles.chunks_x() || ny >= tiles.chunks_y()) return;
+      auto other = chunk_first_room_[nx + ny * tiles.chunks_x()];
+      if (other >= 0) room_links.connect(first, static_cast<std::uint32_t>(other), via);
+    };
+
+    int mx = x0 + size / 2, my = y0 + size / 2;
+    if (mx < width)
+    {
+      join(cx, cy - 1, {mx, y0});
+      join(cx, cy + 1, {mx, std::min(y0 + size, height) - 1});
+    }
+    if (my < height)
+    {
+      join(cx - 1, cy, {x0, my});
+      join(cx + 1, cy, {std::min(x0 + size, width) - 1, my});
+    }
+  }
+
+  void dungeon::stream_around(position center)
+  {
+    if (!streaming) return;
+
+    constexpr int size = chunked_grid<tile_id>::chunk_size;
+    int ccx = center.x / size, ccy = center.y / size;
+    bool changed = false;
+
+    for (int cy = std::max(0, ccy - stream_radius); cy <= std::min(tiles.chunks_y() - 1, ccy + stream_radius); ++cy)
+      for (int cx = std::max(0, ccx - stream_radius); cx <= std::min(tiles.chunks_x() - 1, ccx + stream_radius); ++cx)
+      {
+        if (chunk_states_[cx + cy * tiles.chunks_x()] != Absent) continue;
+        generate_chunk(cx, cy);
+        changed = true;
+      }
+
+    for (int cy = 0; cy < tiles.chunks_y(); ++cy)
+      for (int cx = 0; cx < tiles.chunks_x(); ++cx)
+      {
+        auto& state = chunk_states_[cx + cy * tiles.chunks_x()];
+        if (state != Generated || std::max(std::abs(cx - ccx), std::abs(cy - ccy)) <= evict_radius) continue;
+
+        tiles.drop_chunk(cx, cy);
+        flags.drop_chunk(cx, cy);
+        state = Absent;
+        changed = true;
+      }
+
+    if (changed)
+    {
+      ++revision_;
+      fov_cache_.valid = false;
+    }
+  }
+
+  void dungeon::paint(int x, int y, tile_id tile)
+  {
+    tiles.write(x, y) = tile;
+    flags.write(x, y) = tile_types[tile].flags;
+  }
+
+  void dungeon::carve_h(int x1, int x2, int y, tile_id tile)
+  {
+    for (int x = std::min(x1, x2); x <= std::max(x1, x2); ++x) paint(x, y, tile);
+  }
+
+  void dungeon::carve_v(int y1, int y2, int x, tile_id tile)
+  {
+    for (int y = std::min(y1, y2); y <= std::max(y1, y2); ++y) paint(x, y, tile);
+  }
+
+  dungeon_snapshot dungeon::take_snapshot() const
+  {
+    return {width,
+            height,
+            tile_types,
+            tiles,
+            flags,
+            explored,
+            visible_,
+            visible_origin_,
+            rooms,
+            room_links,
+            chunk_states_,
+            chunk_seen_,
+            chunk_first_room_,
+            seed_};
+  }
+
+  void dungeon::restore(dungeon_snapshot const& snapshot)
+  {
+    width = snapshot.width;
+    height = snapshot.height;
+    tile_types = snapshot.tile_types;
+    tiles = snapshot.tiles;
+    flags = snapshot.flags;
+    explored = snapshot.explored;
+    visible_ = snapshot.visible;
+    visible_origin_ = snapshot.visible_origin;
+    rooms = snapshot.rooms;
+    room_links = snapshot.room_links;
+    chunk_states_ = snapshot.chunk_states;
+    chunk_seen_ = snapshot.chunk_seen;
+    chunk_first_room_ = snapshot.chunk_first_room;
+    seed_ = snapshot.seed;
+
+    ++revision_;
+    fov_cache_.valid = false;
+  }
+
+  void dungeon::encode(byte_writer& out) const
+  {
+    out.put(width);
+    out.put(height);
+    out.put(static_cast<std::uint64_t>(fov));
+    out.put(streaming);
+    out.put(seed_);
+
+    out.put(tile_types.size());
+    for (std::size_t i = 0; i < tile_types.size(); ++i)
+    {
+      auto const& type = tile_types[static_cast<tile_id>(i)];
+      out.put_string(type.name.str());
+      out.put(static_cast<unsigned char>(type.glyph));
+      out.put_string(type.style.str());
+      out.put(type.flags);
+    }
+
+    if (streaming) return;
+
+    out.put(rooms.size());
+    for (auto const& r : rooms)
+    {
+      out.put_int(r.x);
+      out.put_int(r.y);
+      out.put_int(r.w);
+      out.put_int(r.h);
+    }
+
+    // Each corridor once, from its lower numbered room
+    out.put(has_room_graph());
+    for (std::uint32_t i = 0; i < rooms.size() && has_room_graph(); ++i)
+    {
+      auto links = room_links.links(i);
+      auto later = std::count_if(links.begin(), links.end(), [i](auto const& l) { return l.to > i; });
+      out.put(static_cast<std::uint64_t>(later));
+      for (auto const& l : links)
+        if (l.to > i)
+        {
+          out.put(l.to);
+          out.put_int(l.via.x);
+          out.put_int(l.via.y);
+        }
+    }
+
+    // Runs are allowed to wrap over rows, mostly solid levels collapse to a few hundred pairs
+    tile_id current = tiles(0, 0);
+    std::uint64_t run = 0;
+    for (int y = 0; y < height; ++y)
+      for (int x = 0; x < width; ++x)
+      {
+        tile_id t = tiles(x, y);
+        if (t != current)
+        {
+          out.put(run);
+          out.put(current);
+          current = t;
+          run = 0;
+        }
+        ++run;
+      }
+    out.put(run);
+    out.put(current);
   }
 
-  void dungeon::carve_h(int x1, int x2, int y)
+  bool dungeon::decode(byte_reader& in)
   {
-    for (int x = std::min(x1, x2); x <= std::max(x1, x2); ++x) grid(x, y) = '.';
+    constexpr std::uint64_t max_side = 1 << 16;
+    std::uint64_t w = in.get(), h = in.get();
+    if (!in.ok() || w == 0 || h == 0 || w > max_side || h > max_side) return false;
+
+    width = static_cast<int>(w);
+    height = static_cast<int>(h);
+    auto fov_kind = in.get();
+    if (fov_kind > static_cast<std::uint64_t>(fov_algorithm::Symmetric)) return false;
+    fov = static_cast<fov_algorithm>(fov_kind);
+    streaming = in.get() != 0;
+    std::uint64_t seed = in.get();
+
+    tile_registry types;
+    std::uint64_t type_count = in.get();
+    if (type_count == 0 || type_count > 256) return false;
+    for (std::uint64_t i = 0; i < type_count && in.ok(); ++i)
+    {
+      std::string name = in.get_string();
+      char glyph = static_cast<char>(in.get());
+      std::string style = in.get_string();
+      types.add({name, glyph, style, static_cast<std::uint8_t>(in.get())});
+    }
+    if (!in.ok() || types.size() != type_count) return false;
+
+    tile_types = std::move(types);
+    reset_layers();
+    seed_ = seed;
+
+    if (streaming)
+    {
+      stream_around({width / 2, height / 2});
+      return true;
+    }
+
+    std::uint64_t room_count = in.get();
+    if (room_count > w * h) return false;
+    for (std::uint64_t i = 0; i < room_count && in.ok(); ++i)
+    {
+      rectangle r;
+      r.x = static_cast<int>(in.get_int());
+      r.y = static_cast<int>(in.get_int());
+      r.w = static_cast<int>(in.get_int());
+      r.h = static_cast<int>(in.get_int());
+      rooms.push_back(r);
+    }
+
+    bool linked = in.get() != 0;
+    if (linked) room_links.resize(rooms.size());
+    for (std::uint32_t i = 0; i < rooms.size() && linked && in.ok(); ++i)
+    {
+      std::uint64_t count = in.get();
+      if (count > rooms.size()) return false;
+      for (std::uint64_t k = 0; k < count && in.ok(); ++k)
+      {
+        std::uint64_t to = in.get();
+        position via;
+        via.x = static_cast<int>(in.get_int());
+        via.y = static_cast<int>(in.get_int());
+        if (to >= rooms.size()) return false;
+        room_links.connect(i, static_cast<std::uint32_t>(to), via);
+      }
+    }
+
+    // Only tiles differing from the fill value are written, untouched chunks stay unallocated
+    tile_id fill = tiles.fill();
+    std::uint64_t total = w * h, offset = 0;
+    while (offset < total && in.ok())
+    {
+      std::uint64_t run = in.get();
+      std::uint64_t t = in.get();
+      if (run == 0 || run > total - offset || t >= type_count) return false;
+
+      if (t != fill)
+        for (std::uint64_t i = offset; i < offset + run; ++i)
+          paint(static_cast<int>(i % w), static_cast<int>(i / w), static_cast<tile_id>(t));
+      offset += run;
+    }
+    if (!in.ok()) return false;
+
+    std::fill(chunk_states_.begin(), chunk_states_.end(), Pinned);
+    return true;
   }
 
-  void dungeon::carve_v(int y1, int y2, int x)
+  void dungeon::update_flow(position goal)
   {
-    for (int y = std::min(y1, y2); y <= std::max(y1, y2); ++y) grid(x, y) = '.';
+    // revision_ starts at one after reset_layers, so a default flow_revision_ never matches a live map
+    if (flow_revision_ == revision_ && flow_.goal() == goal && flow_.radius() == flow_radius) return;
+
+    flow_.compute(goal, flow_radius, [this](int x, int y) { return is_walkable(x, y); });
+    flow_revision_ = revision_;
   }
 
   bool dungeon::is_walkable(int x, int y) const
   {
-    return y >= 0 && y < height && x >= 0 && x < width && grid(x, y) == '.';
+    return y >= 0 && y < height && x >= 0 && x < width && (flags(x, y) & Walkable);
   }
 
-  void dungeon::update_fov(int px, int py, int range)
+  bool dungeon::blocks_sight(int x, int y) const
+  {
+    return x < 0 || x >= width || y < 0 || y >= height || (flags(x, y) & Opaque);
+  }
+
+  // Always walked from the same end, so both ends of a line agree on whether they see each other
+  bool dungeon::line_clear(position a, position b) const
+  {
+    if (b.y < a.y || (b.y == a.y && b.x < a.x)) std::swap(a, b);
+    int dx = std::abs(b.x - a.x), dy = -std::abs(b.y - a.y);
+    int sx = a.x < b.x ? 1 : -1, sy = a.y < b.y ? 1 : -1, error = dx + dy;
+
+    for (position p = a; !(p == b);)
+    {
+      int e2 = 2 * error;
+      if (e2 >= dy)
+      {
+        error += dy;
+        p.x += sx;
+      }
+      if (e2 <= dx)
+      {
+        error += dx;
+        p.y += sy;
+      }
+      if (!(p == b) && blocks_sight(p.x, p.y)) return false;
+    }
+    return true;
+  }
+
+  std::vector<bool> dungeon::lines_of_sight(std::span<sight_line const> lines) const
+  {
+    auto const& view = fov_cache_;
+    bool symmetric = view.valid && view.algorithm == fov_algorithm::Symmetric && view.revision == revision_;
+    std::vector<bool> clear(lines.size());
+
+    for (std::size_t i = 0; i < lines.size(); ++i)
+    {
+      auto [a, b] = lines[i];
+      if (symmetric && (a == view.origin || b == view.origin))
+      {
+        position other = a == view.origin ? b : a;
+        int dx = other.x - view.origin.x, dy = other.y - view.origin.y;
+        if (dx * dx + dy * dy < view.range * view.range && !blocks_sight(other.x, other.y))
+        {
+          clear[i] = is_visible(other.x, other.y);
+          continue;
+        }
+      }
+      clear[i] = line_clear(a, b);
+    }
+    return clear;
+  }
+
+  void dungeon::raycast_fov(int px, int py, int range)
   {
-    visible_tiles.clear();
     for (int i = 0; i < 360; i += 2)
     {
       double rad = i * 0.0174533;
@@ -75,12 +731,200 @@ namespace roguey
       {
         int ix = static_cast<int>(cur_x), iy = static_cast<int>(cur_y);
         if (ix < 0 || ix >= width || iy < 0 || iy >= height) break;
-        visible_tiles.insert({ix, iy});
-        explored(ix, iy) = true;
-        if (grid(ix, iy) == '#') break;
+        visible_.set(ix - visible_origin_.x, iy - visible_origin_.y);
+        if (std::as_const(flags)(ix, iy) & Opaque) break;
         cur_x += ox;
         cur_y += oy;
       }
     }
   }
+
+  namespace
+  {
+    // Slope as an exact fraction, denominators are always positive
+    struct slope
+    {
+      int num, den;
+
+      friend bool operator<(slope a, slope b) { return a.num * b.den < b.num * a.den; }
+    };
+
+    // Maps (column, row) in octant space to a map offset
+    struct octant
+    {
+      int xx, xy, yx, yy;
+    };
+
+    constexpr octant octants[] = {{1, 0, 0, 1},  {0, 1, 1, 0},  {0, -1, 1, 0},  {-1, 0, 0, 1},
+                                  {-1, 0, 0, -1}, {0, -1, -1, 0}, {0, 1, -1, 0}, {1, 0, 0, -1}};
+
+    // Recursive shadowcasting over one octant.
+    // Rows are scanned outward from the viewer between the start and end slopes, every opaque run splits the
+    // light cone and the part left of it is scanned recursively. Tile edges are at half-integer offsets,
+    // so slopes are kept as fractions of odd integers and compared by cross multiplication.
+    template<typename Opaque, typename Reveal>
+    void cast_light(int cx, int cy, int row, slope start, slope end, int range, octant o, Opaque const& opaque,
+                    Reveal const& reveal)
+    {
+      if (start < end) return;
+
+      for (int depth = row; depth <= range; ++depth)
+      {
+        bool blocked = false;
+        slope next_start = start;
+
+        for (int col = depth; col >= 0; --col)
+        {
+          slope left{2 * col + 1, 2 * depth - 1}, right{2 * col - 1, 2 * depth + 1};
+          if (start < right) continue;
+          if (left < end) break;
+
+          int x = cx - col * o.xx - depth * o.xy, y = cy - col * o.yx - depth * o.yy;
+          if (col * col + depth * depth < range * range) reveal(x, y);
+
+          bool wall = opaque(x, y);
+          if (blocked)
+          {
+            if (wall) next_start = right;
+            else
+            {
+              blocked = false;
+              start = next_start;
+            }
+          }
+          else if (wall && depth < range)
+          {
+            blocked = true;
+            cast_light(cx, cy, depth + 1, start, left, range, o, opaque, reveal);
+            next_start = right;
+          }
+        }
+
+        if (blocked) break;
+      }
+    }
+
+    int floor_div(int a, int b) { return a / b - (a % b != 0 && (a < 0) != (b < 0)); }
+
+    // Symmetric shadowcasting over one octant, with slopes taken at the middle of each row: a tile edge sits at
+    // (2 col - 1) / (2 depth). Walls are lit when the cone touches them, floors only when it covers their center.
+    template<typename Opaque, typename Reveal>
+    void cast_symmetric(int cx, int cy, int row, slope start, slope end, int range, octant o, Opaque const& opaque,
+                        Reveal const& reveal)
+    {
+      for (int depth = row; depth <= range; ++depth)
+      {
+        // Columns whose center is less than half a tile outside the cone
+        int first = std::max(0, floor_div(2 * depth * start.num + start.den, 2 * start.den));
+        int last = std::min(depth, -floor_div(end.den - 2 * depth * end.num, 2 * end.den));
+        int previous = -1;
+
+        for (int col = first; col <= last; ++col)
+        {
+          int x = cx - col * o.xx - depth * o.xy, y = cy - col * o.yx - depth * o.yy;
+          bool wall = opaque(x, y);
+          bool centered = col * start.den >= depth * start.num && col * end.den <= depth * end.num;
+          if ((wall || centered) && col * col + depth * depth < range * range) reveal(x, y);
+
+          if (previous == 1 && !wall) start = {2 * col - 1, 2 * depth};
+          if (previous == 0 && wall)
+            cast_symmetric(cx, cy, depth + 1, start, {2 * col - 1, 2 * depth}, range, o, opaque, reveal);
+          previous = wall;
+        }
+
+        if (previous != 0) return;
+      }
+    }
+  }
+
+  // An octant pass reads nothing outside its own wedge, so the octants left out of redo keep their last result
+  void dungeon::shadowcast_fov(int px, int py, int range, std::uint8_t redo)
+  {
+    auto opaque = [this](int x, int y) { return blocks_sight(x, y); };
+
+    for (int k = 0; k < 8; ++k)
+    {
+      auto& octant_lit = fov_cache_.octant_lit[k];
+      if (redo & (1 << k))
+      {
+        if (octant_lit.width() != visible_.width()) octant_lit = bit_grid(visible_.width(), visible_.height());
+        else octant_lit.clear();
+
+        auto lit = [&](int x, int y) {
+          if (x >= 0 && x < width && y >= 0 && y < height)
+            octant_lit.set(x - visible_origin_.x, y - visible_origin_.y);
+        };
+        if (fov == fov_algorithm::Symmetric) cast_symmetric(px, py, 1, {0, 1}, {1, 1}, range, octants[k], opaque, lit);
+        else cast_light(px, py, 1, {1, 1}, {0, 1}, range, octants[k], opaque, lit);
+      }
+      visible_ |= octant_lit;
+    }
+    visible_.set(range, range);
+  }
+
+  void dungeon::update_fov(int px, int py, int range)
+  {
+    auto& cache = fov_cache_;
+    bool same_view = cache.valid && cache.origin == position{px, py} && cache.range == range && cache.algorithm == fov;
+    if (same_view && cache.revision == revision_) return;
+
+    // The visible layer only spans the square the viewer can reach
+    if (visible_.width() != 2 * range + 1) visible_ = bit_grid(2 * range + 1, 2 * range + 1);
+    else visible_.clear();
+    visible_origin_ = {px - range, py - range};
+
+    if (fov == fov_algorithm::Raycast) raycast_fov(px, py, range);
+    else if (px >= 0 && px < width && py >= 0 && py < height)
+      shadowcast_fov(px, py, range, same_view ? cache.dirty_octants : 0xFF);
+
+    // Visible flags are merged into explored one chunk row at a time. Lit tiles are only looked at one by one
+    // when the level has tile types that are never remembered.
+    bool all_explorable = true;
+    for (std::size_t t = 0; t < tile_types.size(); ++t)
+      all_explorable &= (tile_types[static_cast<tile_id>(t)].flags & Explorable) != 0;
+
+    int x0 = std::max(visible_origin_.x, 0), x1 = std::min(visible_origin_.x + visible_.width(), width);
+    int y0 = std::max(visible_origin_.y, 0), y1 = std::min(visible_origin_.y + visible_.height(), height);
+    constexpr int row_bits = chunked_bit_grid::chunk_size;
+    for (int y = y0; y < y1; ++y)
+      for (int cx = x0 - x0 % row_bits; cx < x1; cx += row_bits)
+      {
+        auto lit = visible_.bits(cx - visible_origin_.x, y - visible_origin_.y);
+        if (x1 - cx < row_bits) lit &= (std::uint64_t{1} << (x1 - cx)) - 1;
+
+        for (auto rest = all_explorable ? 0 : lit; rest; rest &= rest - 1)
+        {
+          int bit = std::countr_zero(rest);
+          if (!(std::as_const(flags)(cx + bit, y) & Explorable)) lit &= ~(std::uint64_t{1} << bit);
+        }
+        explored.merge(cx, y, lit);
+      }
+
+    cache.valid = true;
+    cache.origin = {px, py};
+    cache.range = range;
+    cache.algorithm = fov;
+    cache.revision = revision_;
+    cache.dirty_octants = 0;
+  }
+
+  void dungeon::set_tile(int x, int y, tile_id tile)
+  {
+    if (tiles(x, y) == tile) return;
+    bool sight_changed = (tile_types[tiles(x, y)].flags ^ tile_types[tile].flags) & Opaque;
+    paint(x, y, tile);
+    chunk_states_[x / tiles.chunk_size + (y / tiles.chunk_size) * tiles.chunks_x()] = Pinned;
+    ++revision_;
+    if (!fov_cache_.valid || !sight_changed) return;
+
+    // Octants are signed permutations of (column, depth), so the transpose maps the offset back into octant space.
+    // Tiles on an axis or a diagonal belong to both octants sharing it.
+    int dx = x - fov_cache_.origin.x, dy = y - fov_cache_.origin.y;
+    for (int k = 0; k < 8; ++k)
+    {
+      auto const& o = octants[k];
+      int col = -(o.xx * dx + o.yx * dy), depth = -(o.xy * dx + o.yy * dy);
+      if (col >= 0 && col <= depth && depth <= fov_cache_.range) fov_cache_.dirty_octants |= 1 << k;
+    }
+  }
 }
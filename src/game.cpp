@@ -8,22 +8,43 @@
 #include "dice.hpp"
 #include "game.hpp"
 #include <algorithm>
+#include <array>
 #include <cctype>
+#include <charconv>
 #include <filesystem>
 #include <map>
+#include <memory_resource>
+#include <optional>
 #include <random>
 
 namespace fs = std::filesystem;
 
 namespace roguey
 {
-  game::game(bool debug) : debug_mode(debug), map(80, 20), scripts{"scripts/game.lua"}, random_generator(random_bits())
+  game::game(bool debug)
+      : debug_mode(debug), map(80, 20, &arena), scripts{"scripts/game.lua"}, random_generator(random_bits())
   {
     if (!scripts.is_valid) { exit(1); }
 
     renderer.load_config(scripts.lua);
+    scripts.set_pathfinder(&paths);
+
+    // Every requester has a position, losing it means the entity is gone and its cached path with it
+    reg.positions.on_destroy([this](entity_id id) { paths.forget(id); });
+    reg.positions.track_changes(true);
     scripts.lua.set_function("roll", [prng = &random_generator](std::string const& dice) { return roll(dice, *prng); });
 
+    // Monster scripts descend the shared flow field instead of each searching a path to the player
+    scripts.lua.set_function("flow_step", [this](int x, int y) {
+      position step = map.flow_step(x, y);
+      return std::make_tuple(step.x, step.y);
+    });
+    scripts.lua.set_function("flow_distance", [this](int x, int y) -> sol::optional<int> {
+      auto d = map.flow_distance(x, y);
+      if (d == distance_field::unreachable) return sol::nullopt;
+      return d;
+    });
+
     running = true;
     buffered_event = ftxui::Event::Special({0});
   }
@@ -43,82 +64,114 @@ namespace roguey
   bool game::on_event(ftxui::Event event)
   {
     if (menu_lock > 0) menu_lock--;
-    return machine.on_event(*this, event);
+    bool handled = machine.on_event(*this, event);
+
+    // Structural changes recorded by the systems during this event are applied in one batch
+    reg.flush();
+    return handled;
   }
 
   void game::spawn_item(int x, int y, std::string script_path)
   {
-    if (!systems::execute_script(scripts.lua, script_path, log)) return;
+    auto const* script = scripts.script(script_path, log);
+    if (!script) return;
 
-    auto data_opt = systems::try_get_table(scripts.lua, "item_data", log);
+    auto data_opt = systems::try_get_table(script->item_data, "item_data", log);
     if (!data_opt) return;
-    sol::table data = *data_opt;
-
-    entity_id id = reg.create_entity();
-    reg.positions[id] = {x, y};
 
-    std::string glyph_str = data["glyph"];
-    std::string cid = data.get_or<std::string>("color", "item_gold");
-    reg.renderables[id] = {glyph_str[0], cid};
-
-    item_type kind;
-    std::string item_kind = data["kind"];
-    if (item_kind == "consumable") kind = item_type::Consumable;
-    else if (item_kind == "gold") kind = item_type::Gold;
-
-    reg.items[id] = {kind, 0, data["name"], script_path};
-    reg.names[id] = data["name"];
+    instantiate_item({x, y}, script_path, systems::parse_item_config(*data_opt));
   }
 
   bool game::spawn_monster(int x, int y, std::string script_path)
   {
-    if (debug_mode) { log.add("Spawning: " + script_path, "ui_emphasis"); }
+    auto const* script = scripts.script(script_path, log);
+    if (!script) return false;
 
-    if (!systems::execute_script(scripts.lua, script_path, log)) return false;
-
-    entity_id id = reg.create_entity();
-    reg.positions[id] = {x, y};
-    reg.script_paths[id] = script_path;
-    reg.monsters.push_back(id);
-
-    sol::protected_function init_func = scripts.lua["get_init_stats"];
-    auto result = init_func();
+    auto result = script->get_init_stats();
 
     if (!result.valid())
     {
       sol::error err = result;
       if (debug_mode) log.add("Lua Error: " + std::string(err.what()), "ui_failure");
-      reg.destroy_entity(id);
       return false;
     }
 
     sol::table s = result;
-    auto cfg = systems::parse_entity_config(s, fs::path(script_path).stem().string());
+    instantiate_monster({x, y}, script_path, systems::parse_entity_config(s, fs::path(script_path).stem().string()));
+    return true;
+  }
 
-    int start_timer = std::uniform_int_distribution<>(0, cfg.stats.action_delay)(random_generator);
-    cfg.stats.action_timer = start_timer;
+  void game::instantiate_item(position at, std::string const& script_path, systems::item_data const& data)
+  {
+    entity_id id = reg.create_entity();
+    reg.renderables[id] = data.render;
+    reg.items[id] = {data.kind, 0, data.name, script_path};
+    reg.names[id] = data.name;
+    reg.place(id, at);
+  }
+
+  entity_id game::instantiate_monster(position at, std::string const& script_path, systems::entity_data const& cfg)
+  {
+    if (debug_mode) { log.add("Spawning: " + script_path, "ui_emphasis"); }
+
+    entity_id id = reg.create_entity();
+    reg.script_paths[id] = script_path;
+
+    int start_timer = std::uniform_int_distribution<>(0, cfg.delay)(random_generator);
 
     reg.stats[id] = cfg.stats;
+    reg.timers.emplace(id, cfg.delay, start_timer);
     reg.renderables[id] = cfg.render;
     reg.names[id] = cfg.name;
+    reg.place(id, at);
 
     if (cfg.type == "boss") reg.boss_id = id;
 
-    return true;
+    return id;
   }
 
   void game::reset(bool full_reset, std::string level_script)
   {
+    // Descending keeps a snapshot of the floor being left, so a floor that fails to build leaves the player there
+    std::optional<registry_snapshot> previous;
+    std::optional<dungeon_snapshot> previous_map;
+    std::string previous_script = current_level_script;
+    compiled_script const* previous_hooks = level_hooks;
+    if (!full_reset)
+    {
+      reg.flush();
+      previous = reg.take_snapshot();
+      previous_map = map.take_snapshot();
+    }
+
+    auto stay_on_floor = [&] {
+      if (!previous)
+      {
+        stop();
+        return;
+      }
+
+      reg.restore(*previous);
+      map.restore(*previous_map);
+      paths.clear_cache();
+      current_level_script = previous_script;
+      level_hooks = previous_hooks;
+      depth--;
+      log.add("The way down is blocked, you stay on this floor", "ui_failure");
+    };
+
     stats saved_stats;
+    int saved_delay = 0;
     if (!full_reset)
     {
       saved_stats = reg.stats[reg.player_id];
-      saved_stats.action_timer = 0;
+      saved_delay = reg.timers.delay(reg.player_id);
       depth++;
     }
     else
     {
       depth = 1;
+      run_seed = (std::uint64_t{random_bits()} << 32) | random_bits();
       inventory.clear();
       last_dx = 1; // Reset direction on full reset
       last_dy = 0;
@@ -130,74 +183,154 @@ namespace roguey
     reg.boss_id = 0;            // Ensure no lingering boss ID causes instant victory
     has_buffered_event = false; // Clear input buffer to prevent accidental moves
 
-    systems::execute_script(scripts.lua, current_level_script, log);
-    sol::table config = scripts.lua["get_level_config"](depth);
+    // Drop the previous level storage before handing the whole arena back
+    map.rooms = std::pmr::vector<rectangle>(&arena);
+    arena.release();
 
-    map.width = config["width"];
-    map.height = config["height"];
-    map.generate(random_generator);
+    // The floor is normally built in the background while the previous one was played
+    auto seed = floor_seed(run_seed, depth);
+    auto level = builder.take(current_level_script, depth, seed);
+    if (!level) level = builder.build(current_level_script, depth, seed);
+    for (auto const& entry : level->log.messages) log.add(entry.text, entry.color);
+
+    if (!level->valid)
+    {
+      log.add("Could not build level " + current_level_script, "ui_failure");
+      stay_on_floor();
+      return;
+    }
+
+    // Level hooks are still called from the game state during play
+    level_hooks = scripts.script(current_level_script, log);
+    if (!level_hooks)
+    {
+      stay_on_floor();
+      return;
+    }
+
+    map = std::move(level->map);
+    paths.clear_cache();
+    reg.occupancy.resize(map.width, map.height);
 
     reg.player_id = reg.create_entity();
-    reg.positions[reg.player_id] = map.rooms[0].center();
 
     reg.renderables[reg.player_id] = {'@', "entity_player"};
     reg.names[reg.player_id] = reg.player_name;
 
     if (full_reset)
     {
-      systems::execute_script(scripts.lua, reg.player_class_script, log);
-      sol::protected_function init_func = scripts.lua["get_init_stats"];
-      sol::table s = init_func();
+      auto const* script = scripts.script(reg.player_class_script, log);
+      if (!script)
+      {
+        stop();
+        return;
+      }
+      sol::table s = script->get_init_stats();
 
       auto cfg = systems::parse_entity_config(s, "Hero");
       reg.stats[reg.player_id] = cfg.stats;
+      reg.timers.emplace(reg.player_id, cfg.delay);
     }
-    else { reg.stats[reg.player_id] = saved_stats; }
+    else
+    {
+      reg.stats[reg.player_id] = saved_stats;
+      reg.timers.emplace(reg.player_id, saved_delay);
+    }
+    reg.place(reg.player_id, map.rooms[0].center());
 
-    std::string next_level_path = scripts.lua["get_next_level"](depth);
+    std::string next_level_path = level_hooks->get_next_level(depth);
 
-    if (config["is_boss_level"].get_or(false))
+    if (level->boss)
     {
-      spawn_monster(map.rooms.back().center().x, map.rooms.back().center().y, scripts.lua["get_boss_script"](depth));
+      if (auto it = level->monsters.find(level->boss->script); it != level->monsters.end())
+        instantiate_monster(level->boss->at, level->boss->script, it->second);
     }
 
     entity_id stairs = reg.create_entity();
-    reg.positions[stairs] = map.rooms.back().center();
     reg.renderables[stairs] = {'>', "ui_gold"};
     reg.items[stairs] = {item_type::Stairs, 0, next_level_path, ""};
     reg.names[stairs] = "Stairs";
+    reg.place(stairs, map.rooms.back().center());
+
+    spawn_orders(level->spawns, &*level);
 
-    sol::table monster_weights = scripts.lua["get_spawn_odds"](depth);
-    sol::table item_weights = scripts.lua["get_loot_odds"](depth);
+    if (debug_mode)
+    {
+      log.add("Level arena high-water mark: " + std::to_string(arena.high_water() / 1024) + " KiB", "ui_default");
+    }
 
-    std::map<std::string, int> spawn_counts;
+    map.update_fov(reg.positions.at(reg.player_id).x, reg.positions.at(reg.player_id).y, 8);
+    map.update_flow(reg.positions.at(reg.player_id));
 
-    for (std::size_t i = 1; i < map.rooms.size() - 1; ++i)
+    builder.start(next_level_path, depth + 1, floor_seed(run_seed, depth + 1));
+  }
+
+  void game::stream_level()
+  {
+    if (!reg.positions.contains(reg.player_id)) return;
+
+    // Positions are change tracked, this is their only consumer: chunks around the player only need streaming
+    // once it moved since the last call
+    auto moved = reg.positions.changes();
+    bool player_moved = std::ranges::find(moved, reg.player_id) != moved.end();
+    reg.positions.clear_changes();
+    if (!player_moved) return;
+
+    // Rooms of freshly built chunks get their share of monsters and loot
+    std::size_t known = map.rooms.size();
+    map.stream_around(reg.positions.at(reg.player_id));
+    if (map.rooms.size() > known) populate_rooms(known, map.rooms.size());
+  }
+
+  void game::populate_rooms(std::size_t first, std::size_t last)
+  {
+    auto rooms = std::span<rectangle const>(map.rooms).subspan(first, last - first);
+    spawn_orders(plan_spawns(scripts, *level_hooks, rooms, depth, random_generator));
+  }
+
+  void game::spawn_orders(std::span<spawn_order const> orders, prepared_level const* prepared)
+  {
+    // Bookkeeping and the debug line below only live for this call. They use a scratch arena of their own, as
+    // streamed levels call this many times and the level arena is only released on reset.
+    std::array<std::byte, 2048> buffer;
+    std::pmr::monotonic_buffer_resource scratch(buffer.data(), buffer.size());
+    std::pmr::map<std::pmr::string, int> spawn_counts(&scratch);
+
+    for (auto const& order : orders)
     {
-      position c = map.rooms[i].center();
-      int roll = std::uniform_int_distribution<>(0, 10)(random_generator);
-      if (roll < 3)
+      if (order.kind == spawn_kind::Item)
+      {
+        if (!prepared) spawn_item(order.at.x, order.at.y, order.script);
+        else if (auto it = prepared->items.find(order.script); it != prepared->items.end())
+          instantiate_item(order.at, order.script, it->second);
+        continue;
+      }
+
+      bool spawned = false;
+      if (!prepared) spawned = spawn_monster(order.at.x, order.at.y, order.script);
+      else if (auto it = prepared->monsters.find(order.script); it != prepared->monsters.end())
       {
-        std::string path = scripts.pick_from_weights(item_weights, random_generator);
-        if (!path.empty()) spawn_item(c.x, c.y, path);
+        instantiate_monster(order.at, order.script, it->second);
+        spawned = true;
       }
-      else if (roll < 7)
+
+      if (spawned)
       {
-        std::string path = scripts.pick_from_weights(monster_weights, random_generator);
-        if (!path.empty())
-        {
-          if (spawn_monster(c.x, c.y, path)) { spawn_counts[fs::path(path).stem().string()]++; }
-        }
+        auto stem = fs::path(order.script).stem().string();
+        spawn_counts[std::pmr::string(stem.begin(), stem.end(), &scratch)]++;
       }
     }
 
     if (debug_mode)
     {
-      std::string debug_msg = "Debug Spawn: ";
-      for (auto const& [name, count] : spawn_counts) { debug_msg += name + " x" + std::to_string(count) + " "; }
-      log.add(debug_msg, "ui_gold");
+      std::pmr::string debug_msg("Debug Spawn: ", &scratch);
+      for (auto const& [name, count] : spawn_counts)
+      {
+        char number[16];
+        auto end = std::to_chars(number, number + sizeof(number), count).ptr;
+        debug_msg.append(name).append(" x").append(number, end).append(" ");
+      }
+      log.add(std::string(debug_msg), "ui_gold");
     }
-
-    map.update_fov(reg.positions[reg.player_id].x, reg.positions[reg.player_id].y, 8);
   }
 }
@@ -0,0 +1,374 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#include "dice.hpp"
+#include "level_builder.hpp"
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace roguey
+{
+  std::vector<spawn_order> plan_spawns(script_engine& engine, compiled_script const& level,
+                                       std::span<rectangle const> rooms, int depth, std::mt19937& gen)
+  {
+    sol::table monster_weights = level.get_spawn_odds(depth);
+    sol::table item_weights = level.get_loot_odds(depth);
+
+    std::vector<spawn_order> orders;
+    for (auto const& room : rooms)
+    {
+      int roll = std::uniform_int_distribution<>(0, 10)(gen);
+      if (roll < 3)
+      {
+        std::string path = engine.pick_from_weights(item_weights, gen);
+        if (!path.empty()) orders.push_back({spawn_kind::Item, room.center(), path});
+      }
+      else if (roll < 7)
+      {
+        std::string path = engine.pick_from_weights(monster_weights, gen);
+        if (!path.empty()) orders.push_back({spawn_kind::Monster, room.center(), path});
+      }
+    }
+    return orders;
+  }
+
+  namespace
+  {
+    void prepare_monster(prepared_level& level, script_engine& engine, std::string const& path)
+    {
+      if (level.monsters.contains(path)) return;
+      auto const* script = engine.script(path, level.log);
+      if (!script) return;
+
+      auto result = script->get_init_stats();
+      if (!result.valid())
+      {
+        sol::error err = result;
+        level.log.add("Lua Error: " + std::string(err.what()), "ui_failure");
+        return;
+      }
+
+      sol::table s = result;
+      level.monsters[path] = systems::parse_entity_config(s, fs::path(path).stem().string());
+    }
+
+    void prepare_item(prepared_level& level, script_engine& engine, std::string const& path)
+    {
+      if (level.items.contains(path)) return;
+      auto const* script = engine.script(path, level.log);
+      if (!script) return;
+
+      auto data = systems::try_get_table(script->item_data, "item_data", level.log);
+      if (data) level.items[path] = systems::parse_item_config(*data);
+    }
+
+    constexpr std::uint64_t level_format = 3;
+
+    void encode_order(spawn_order const& order, byte_writer& out)
+    {
+      out.put(static_cast<std::uint64_t>(order.kind));
+      out.put_int(order.at.x);
+      out.put_int(order.at.y);
+      out.put_string(order.script);
+    }
+
+    spawn_order decode_order(byte_reader& in)
+    {
+      spawn_order order;
+      order.kind = in.get() ? spawn_kind::Item : spawn_kind::Monster;
+      order.at.x = static_cast<int>(in.get_int());
+      order.at.y = static_cast<int>(in.get_int());
+      order.script = in.get_string();
+      return order;
+    }
+
+    void encode_monster(systems::entity_data const& cfg, byte_writer& out)
+    {
+      auto const& s = cfg.stats;
+      out.put_string(s.archetype.str());
+      for (int v : {s.hp, s.max_hp, s.mana, s.max_mana, s.damage, s.xp, s.level, s.fov_range, s.gold, cfg.delay})
+        out.put_int(v);
+      out.put(static_cast<unsigned char>(cfg.render.glyph));
+      out.put_string(cfg.render.color.str());
+      out.put_string(cfg.name.str());
+      out.put_string(cfg.type.str());
+    }
+
+    systems::entity_data decode_monster(byte_reader& in)
+    {
+      systems::entity_data cfg;
+      auto& s = cfg.stats;
+      s.archetype = in.get_string();
+      for (int* v : {&s.hp, &s.max_hp, &s.mana, &s.max_mana, &s.damage, &s.xp, &s.level, &s.fov_range, &s.gold,
+                     &cfg.delay})
+        *v = static_cast<int>(in.get_int());
+      cfg.render.glyph = static_cast<char>(in.get());
+      cfg.render.color = in.get_string();
+      cfg.name = in.get_string();
+      cfg.type = in.get_string();
+      return cfg;
+    }
+
+    void encode_item(systems::item_data const& data, byte_writer& out)
+    {
+      out.put(static_cast<unsigned char>(data.render.glyph));
+      out.put_string(data.render.color.str());
+      out.put(static_cast<std::uint64_t>(data.kind));
+      out.put_string(data.name.str());
+    }
+
+    systems::item_data decode_item(byte_reader& in)
+    {
+      systems::item_data data;
+      data.render.glyph = static_cast<char>(in.get());
+      data.render.color = in.get_string();
+      data.kind = in.get() == static_cast<std::uint64_t>(item_type::Gold) ? item_type::Gold : item_type::Consumable;
+      data.name = in.get_string();
+      return data;
+    }
+
+    constexpr char const* game_script = "scripts/game.lua";
+  }
+
+  std::uint32_t floor_seed(std::uint64_t run_seed, int depth)
+  {
+    // splitmix64 finalizer, neighbouring depths get unrelated seeds
+    std::uint64_t z = run_seed + 0x9E3779B97F4A7C15ull * static_cast<std::uint64_t>(depth + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<std::uint32_t>(z ^ (z >> 31));
+  }
+
+  void encode_level(prepared_level const& level, byte_writer& out)
+  {
+    out.put(level_format);
+    out.put_string(level.script);
+    out.put_int(level.depth);
+    out.put(level.seed);
+    level.map.encode(out);
+
+    out.put(level.boss.has_value());
+    if (level.boss) encode_order(*level.boss, out);
+
+    out.put(level.spawns.size());
+    for (auto const& order : level.spawns) encode_order(order, out);
+
+    out.put(level.monsters.size());
+    for (auto const& [path, cfg] : level.monsters)
+    {
+      out.put_string(path);
+      encode_monster(cfg, out);
+    }
+
+    out.put(level.items.size());
+    for (auto const& [path, data] : level.items)
+    {
+      out.put_string(path);
+      encode_item(data, out);
+    }
+  }
+
+  std::optional<prepared_level> decode_level(byte_reader& in)
+  {
+    if (in.get() != level_format) return std::nullopt;
+
+    prepared_level level;
+    level.script = in.get_string();
+    level.depth = static_cast<int>(in.get_int());
+    level.seed = static_cast<std::uint32_t>(in.get());
+    if (!in.ok() || !level.map.decode(in)) return std::nullopt;
+
+    if (in.get()) level.boss = decode_order(in);
+
+    // Counts are bounded by what is left to read, so a corrupted count fails fast instead of allocating
+    std::uint64_t spawns = in.get();
+    if (spawns > in.remaining().size()) return std::nullopt;
+    for (std::uint64_t i = 0; i < spawns && in.ok(); ++i) level.spawns.push_back(decode_order(in));
+
+    std::uint64_t monsters = in.get();
+    if (monsters > in.remaining().size()) return std::nullopt;
+    for (std::uint64_t i = 0; i < monsters && in.ok(); ++i)
+    {
+      std::string path = in.get_string();
+      level.monsters[path] = decode_monster(in);
+    }
+
+    std::uint64_t items = in.get();
+    if (items > in.remaining().size()) return std::nullopt;
+    for (std::uint64_t i = 0; i < items && in.ok(); ++i)
+    {
+      std::string path = in.get_string();
+      level.items[path] = decode_item(in);
+    }
+
+    if (!in.ok() || !in.at_end()) return std::nullopt;
+    level.valid = true;
+    return level;
+  }
+
+  prepared_level build_level(std::string script, int depth, std::uint32_t seed)
+  {
+    prepared_level level;
+    level.script = std::move(script);
+    level.depth = depth;
+    level.seed = seed;
+
+    std::mt19937 gen(seed);
+    script_engine engine(game_script);
+    if (!engine.is_valid) return level;
+    engine.lua.set_function("roll", [&gen](std::string const& dice) { return roll(dice, gen); });
+
+    auto const* hooks = engine.script(level.script, level.log);
+    if (!hooks) return level;
+    sol::table config = hooks->get_level_config(depth);
+
+    auto& map = level.map;
+    map.width = config["width"];
+    map.height = config["height"];
+    map.tile_types = systems::parse_tile_config(config);
+    map.streaming = config["streaming"].get_or(false);
+
+    std::string fov_kind = config["fov"].get_or<std::string>("shadowcast");
+    map.fov = fov_kind == "raycast"     ? fov_algorithm::Raycast
+            : fov_kind == "symmetric" ? fov_algorithm::Symmetric
+                                      : fov_algorithm::Shadowcast;
+
+    if (sol::optional<sol::table> generator = config["generator"]; generator)
+    {
+      std::string kind = (*generator)["kind"].get_or<std::string>("rooms");
+      map.generator = kind == "caves" ? level_generator::Caves : level_generator::Rooms;
+      map.caves.fill = (*generator)["fill"].get_or(map.caves.fill);
+      map.caves.iterations = (*generator)["iterations"].get_or(map.caves.iterations);
+      map.caves.spot_spacing = (*generator)["spot_spacing"].get_or(map.caves.spot_spacing);
+    }
+    map.generate(gen);
+    if (map.rooms.empty()) return level;
+
+    // A level script without a boss hook, or whose hook returns nothing, gets no boss
+    if (config["is_boss_level"].get_or(false) && hooks->get_boss_script.valid())
+    {
+      auto result = hooks->get_boss_script(depth);
+      if (!result.valid())
+      {
+        sol::error err = result;
+        level.log.add("Lua Error: " + std::string(err.what()), "ui_failure");
+      }
+      else if (auto boss = result.get<sol::optional<std::string>>())
+        level.boss = spawn_order{spawn_kind::Monster, map.rooms.back().center(), *boss};
+    }
+
+    // The first room holds the player and the last one the stairs
+    if (map.rooms.size() > 2)
+    {
+      auto rooms = std::span<rectangle const>(map.rooms).subspan(1, map.rooms.size() - 2);
+      level.spawns = plan_spawns(engine, *hooks, rooms, depth, gen);
+    }
+
+    // Every script is run once here, the game only copies the resulting prototypes
+    if (level.boss) prepare_monster(level, engine, level.boss->script);
+    for (auto const& order : level.spawns)
+    {
+      if (order.kind == spawn_kind::Monster) prepare_monster(level, engine, order.script);
+      else prepare_item(level, engine, order.script);
+    }
+
+    level.valid = true;
+    return level;
+  }
+
+  std::optional<std::vector<std::uint8_t>> level_cache::find(std::string const& script, int depth,
+                                                              std::uint32_t seed)
+  {
+    std::lock_guard lock(mutex_);
+    auto it = entries_.find(key{script, depth, seed});
+    if (it == entries_.end()) return std::nullopt;
+
+    it->second.last_use = ++uses_;
+    return it->second.bytes;
+  }
+
+  void level_cache::store(std::string const& script, int depth, std::uint32_t seed, std::vector<std::uint8_t> bytes)
+  {
+    if (capacity_ == 0) return;
+
+    std::lock_guard lock(mutex_);
+    key k{script, depth, seed};
+    if (!entries_.contains(k) && entries_.size() >= capacity_)
+    {
+      auto older = [](auto const& a, auto const& b) { return a.second.last_use < b.second.last_use; };
+      entries_.erase(std::min_element(entries_.begin(), entries_.end(), older));
+    }
+    entries_[k] = {std::move(bytes), ++uses_};
+  }
+
+  level_builder::~level_builder()
+  {
+    discard();
+  }
+
+  prepared_level level_builder::build(std::string const& script, int depth, std::uint32_t seed)
+  {
+    if (auto bytes = cache_.find(script, depth, seed))
+    {
+      byte_reader in(*bytes);
+      auto level = decode_level(in);
+      if (level && level->script == script && level->depth == depth && level->seed == seed) return std::move(*level);
+    }
+
+    auto level = build_level(script, depth, seed);
+    if (level.valid)
+    {
+      std::vector<std::uint8_t> bytes;
+      byte_writer out(bytes);
+      encode_level(level, out);
+      cache_.store(script, depth, seed, std::move(bytes));
+    }
+    return level;
+  }
+
+  void level_builder::start(std::string script, int depth, std::uint32_t seed)
+  {
+    discard();
+    script_ = script;
+    depth_ = depth;
+    seed_ = seed;
+    pending_ = std::async(std::launch::async, [this, script = std::move(script), depth, seed] {
+      return build(script, depth, seed);
+    });
+  }
+
+  std::optional<prepared_level> level_builder::take(std::string const& script, int depth, std::uint32_t seed)
+  {
+    if (!pending_.valid()) return std::nullopt;
+    if (script != script_ || depth != depth_ || seed != seed_)
+    {
+      discard();
+      return std::nullopt;
+    }
+
+    try
+    {
+      return pending_.get();
+    }
+    catch (std::exception const& e)
+    {
+      // The worker only gave a head start: the level is built again here, with the failure in its log
+      auto level = build(script, depth, seed);
+      level.log.add("Background level build failed: " + std::string(e.what()), "ui_failure");
+      return level;
+    }
+  }
+
+  void level_builder::discard()
+  {
+    if (pending_.valid()) pending_.wait();
+    pending_ = {};
+  }
+}
@@ -0,0 +1,345 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#include "pathfinder.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+namespace roguey
+{
+  namespace
+  {
+    // Octile distance in tenths of a tile, the heuristic and the edge cost between jump points
+    std::uint32_t octile(position a, position b)
+    {
+      int dx = std::abs(a.x - b.x), dy = std::abs(a.y - b.y);
+      return 10 * std::max(dx, dy) + 4 * std::min(dx, dy);
+    }
+
+    int sign(int v) { return (v > 0) - (v < 0); }
+
+    // Heap entries are (f, node), smallest f on top
+    using entry = std::pair<std::uint32_t, std::uint32_t>;
+    constexpr auto by_cost = std::greater<entry>{};
+  }
+
+  bool pathfinder::walkable(int x, int y) const
+  {
+    return x >= window_.x && y >= window_.y && x < window_.x + window_.w && y < window_.y + window_.h &&
+           map_->is_walkable(x, y);
+  }
+
+  // Jump points rules for moves that never cut corners: straight runs stop next to a wall ending beside them,
+  // diagonal runs stop where a straight run from them would, and a diagonal needs both orthogonal tiles open.
+  std::optional<position> pathfinder::jump(int x, int y, int dx, int dy) const
+  {
+    while (walkable(x, y))
+    {
+      if (x == goal_.x && y == goal_.y) return position{x, y};
+
+      if (dx && dy)
+      {
+        if (jump(x + dx, y, dx, 0) || jump(x, y + dy, 0, dy)) return position{x, y};
+        if (!walkable(x + dx, y) || !walkable(x, y + dy)) return std::nullopt;
+      }
+      else if (dx)
+      {
+        if ((walkable(x, y - 1) && !walkable(x - dx, y - 1)) || (walkable(x, y + 1) && !walkable(x - dx, y + 1)))
+          return position{x, y};
+      }
+      else if ((walkable(x - 1, y) && !walkable(x - 1, y - dy)) || (walkable(x + 1, y) && !walkable(x + 1, y - dy)))
+        return position{x, y};
+
+      x += dx;
+      y += dy;
+    }
+    return std::nullopt;
+  }
+
+  void pathfinder::open(std::uint32_t parent, position to)
+  {
+    position from = global(parent);
+    auto jp = jump(to.x, to.y, to.x - from.x, to.y - from.y);
+    if (!jp) return;
+
+    auto& n = nodes_[local(*jp)];
+    std::uint32_t g = nodes_[parent].g + octile(from, *jp);
+    if (n.stamp == search_ && (n.closed || n.g <= g)) return;
+
+    n = {search_, g, parent, false};
+    heap_.emplace_back(g + octile(*jp, goal_), local(*jp));
+    std::push_heap(heap_.begin(), heap_.end(), by_cost);
+  }
+
+  // Only the neighbours a path through current could need are searched, given the direction it was entered from
+  void pathfinder::expand(std::uint32_t current)
+  {
+    position p = global(current);
+    auto const& n = nodes_[current];
+
+    if (n.parent == current)
+    {
+      for (int dy = -1; dy <= 1; ++dy)
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+          if ((dx || dy) && walkable(p.x + dx, p.y + dy) && walkable(p.x + dx, p.y) && walkable(p.x, p.y + dy))
+            open(current, {p.x + dx, p.y + dy});
+        }
+      return;
+    }
+
+    position from = global(n.parent);
+    int dx = sign(p.x - from.x), dy = sign(p.y - from.y);
+
+    if (dx && dy)
+    {
+      bool side_x = walkable(p.x + dx, p.y), side_y = walkable(p.x, p.y + dy);
+      if (side_y) open(current, {p.x, p.y + dy});
+      if (side_x) open(current, {p.x + dx, p.y});
+      if (side_x && side_y) open(current, {p.x + dx, p.y + dy});
+    }
+    else if (dx)
+    {
+      bool next = walkable(p.x + dx, p.y), up = walkable(p.x, p.y - 1), down = walkable(p.x, p.y + 1);
+      if (next) open(current, {p.x + dx, p.y});
+      if (next && up) open(current, {p.x + dx, p.y - 1});
+      if (next && down) open(current, {p.x + dx, p.y + 1});
+      if (up) open(current, {p.x, p.y - 1});
+      if (down) open(current, {p.x, p.y + 1});
+    }
+    else
+    {
+      bool next = walkable(p.x, p.y + dy), left = walkable(p.x - 1, p.y), right = walkable(p.x + 1, p.y);
+      if (next) open(current, {p.x, p.y + dy});
+      if (next && left) open(current, {p.x - 1, p.y + dy});
+      if (next && right) open(current, {p.x + 1, p.y + dy});
+      if (left) open(current, {p.x - 1, p.y});
+      if (right) open(current, {p.x + 1, p.y});
+    }
+  }
+
+  std::vector<position> const& pathfinder::find(position start, position goal)
+  {
+    path_.clear();
+
+    int x0 = std::max(0, std::min(start.x, goal.x) - search_margin);
+    int y0 = std::max(0, std::min(start.y, goal.y) - search_margin);
+    int x1 = std::min(map_->width - 1, std::max(start.x, goal.x) + search_margin);
+    int y1 = std::min(map_->height - 1, std::max(start.y, goal.y) + search_margin);
+    window_ = {x0, y0, x1 - x0 + 1, y1 - y0 + 1};
+    goal_ = goal;
+
+    if (!walkable(start.x, start.y) || !walkable(goal.x, goal.y)) return path_;
+
+    // Stamps tell this search's nodes from stale ones, the buffer is only wiped when they wrap around
+    if (++search_ == 0)
+    {
+      std::fill(nodes_.begin(), nodes_.end(), node{});
+      search_ = 1;
+    }
+    if (nodes_.size() < std::size_t(window_.w) * window_.h) nodes_.resize(std::size_t(window_.w) * window_.h);
+    heap_.clear();
+
+    std::uint32_t first = local(start);
+    nodes_[first] = {search_, 0, first, false};
+    heap_.emplace_back(octile(start, goal), first);
+
+    while (!heap_.empty())
+    {
+      std::pop_heap(heap_.begin(), heap_.end(), by_cost);
+      auto [f, current] = heap_.back();
+      heap_.pop_back();
+
+      auto& n = nodes_[current];
+      if (n.closed || f != n.g + octile(global(current), goal)) continue;
+      n.closed = true;
+
+      if (current == local(goal))
+      {
+        // Jump points lie on straight or diagonal lines from each other, fill in the tiles between them
+        for (std::uint32_t i = current; nodes_[i].parent != i; i = nodes_[i].parent)
+        {
+          position to = global(i), from = global(nodes_[i].parent);
+          int dx = sign(to.x - from.x), dy = sign(to.y - from.y);
+          for (position t = to; !(t == from); t = {t.x - dx, t.y - dy}) path_.push_back(t);
+        }
+        path_.push_back(start);
+        std::reverse(path_.begin(), path_.end());
+        return path_;
+      }
+
+      expand(current);
+    }
+
+    return path_;
+  }
+
+  std::optional<std::uint32_t> pathfinder::room_near(position p) const
+  {
+    auto const& rooms = map_->rooms;
+    std::optional<std::uint32_t> best;
+    std::uint32_t best_distance = 0;
+
+    for (std::uint32_t i = 0; i < rooms.size(); ++i)
+    {
+      auto const& r = rooms[i];
+      if (p.x >= r.x && p.y >= r.y && p.x < r.x + r.w && p.y < r.y + r.h) return i;
+
+      std::uint32_t d = octile(p, r.center());
+      if (!best || d < best_distance)
+      {
+        best = i;
+        best_distance = d;
+      }
+    }
+    return best;
+  }
+
+  // Plain A* over room centers, costs are the octile lengths of the corridors through their via tile
+  bool pathfinder::route_rooms(std::uint32_t from, std::uint32_t to)
+  {
+    auto const& rooms = map_->rooms;
+    auto const& graph = map_->room_links;
+    route_.clear();
+
+    if (++search_ == 0)
+    {
+      std::fill(nodes_.begin(), nodes_.end(), node{});
+      search_ = 1;
+    }
+    if (nodes_.size() < graph.size()) nodes_.resize(graph.size());
+    heap_.clear();
+
+    position target = rooms[to].center();
+    nodes_[from] = {search_, 0, from, false};
+    heap_.emplace_back(octile(rooms[from].center(), target), from);
+
+    while (!heap_.empty())
+    {
+      std::pop_heap(heap_.begin(), heap_.end(), by_cost);
+      auto [f, current] = heap_.back();
+      heap_.pop_back();
+
+      auto& n = nodes_[current];
+      position c = rooms[current].center();
+      if (n.closed || f != n.g + octile(c, target)) continue;
+      n.closed = true;
+
+      if (current == to)
+      {
+        for (std::uint32_t i = to; i != from; i = nodes_[i].parent) route_.push_back(i);
+        route_.push_back(from);
+        std::reverse(route_.begin(), route_.end());
+        return true;
+      }
+
+      for (auto const& l : graph.links(current))
+      {
+        position next = rooms[l.to].center();
+        std::uint32_t g = n.g + octile(c, l.via) + octile(l.via, next);
+        auto& m = nodes_[l.to];
+        if (m.stamp == search_ && (m.closed || m.g <= g)) continue;
+
+        m = {search_, g, current, false};
+        heap_.emplace_back(g + octile(next, target), l.to);
+        std::push_heap(heap_.begin(), heap_.end(), by_cost);
+      }
+    }
+    return false;
+  }
+
+  std::vector<position> const& pathfinder::find_hierarchical(position start, position goal)
+  {
+    long_path_.clear();
+
+    auto from = room_near(start), to = room_near(goal);
+    if (!from || !to || *from == *to || !map_->has_room_graph()) return find(start, goal);
+
+    // Rooms the graph cannot join may still be joined by edits to the terrain
+    if (!route_rooms(*from, *to)) return find(start, goal);
+
+    // Corridors are straight or bend once between waypoints, so each leg only needs a tight search box
+    auto const& rooms = map_->rooms;
+    waypoints_.assign({start, rooms[route_[0]].center()});
+    for (std::size_t i = 1; i < route_.size(); ++i)
+    {
+      for (auto const& l : map_->room_links.links(route_[i - 1]))
+        if (l.to == route_[i])
+        {
+          waypoints_.push_back(l.via);
+          break;
+        }
+      waypoints_.push_back(rooms[route_[i]].center());
+    }
+    waypoints_.push_back(goal);
+
+    // Room centers sit at odd indices. Crossing a room straight from one of its doors to the next is tried first,
+    // going through its center is the fallback that always fits the corridor layout.
+    int margin = search_margin;
+    search_margin = 2;
+    long_path_.push_back(start);
+    position at = start;
+    for (std::size_t i = 1; i < waypoints_.size(); ++i)
+    {
+      if (waypoints_[i] == at) continue;
+      if (i % 2 && i + 1 < waypoints_.size() && !(waypoints_[i + 1] == at))
+      {
+        if (auto const& shortcut = find(at, waypoints_[i + 1]); !shortcut.empty())
+        {
+          long_path_.insert(long_path_.end(), shortcut.begin() + 1, shortcut.end());
+          at = waypoints_[++i];
+          continue;
+        }
+      }
+
+      auto const& leg = find(at, waypoints_[i]);
+      if (leg.empty())
+      {
+        long_path_.clear();
+        break;
+      }
+      long_path_.insert(long_path_.end(), leg.begin() + 1, leg.end());
+      at = waypoints_[i];
+    }
+    search_margin = margin;
+
+    // Ends away from any room may not reach their nearest room within the leg box, search them whole instead
+    if (long_path_.empty()) return find(start, goal);
+    return long_path_;
+  }
+
+  std::vector<position> const& pathfinder::plan(position start, position goal)
+  {
+    bool near = std::max(std::abs(start.x - goal.x), std::abs(start.y - goal.y)) <= search_margin;
+    return near ? find(start, goal) : find_hierarchical(start, goal);
+  }
+
+  position pathfinder::next_step(entity_id requester, position start, position goal)
+  {
+    auto& c = cache_[requester];
+    auto const& tiles = c.tiles;
+    bool fresh = c.revision == map_->terrain_revision() && c.goal == goal && !tiles.empty();
+
+    // The requester either stayed put or took the step it was given last time
+    if (fresh && !(tiles[c.at] == start))
+    {
+      if (c.at + 1 < tiles.size() && tiles[c.at + 1] == start) ++c.at;
+      else fresh = false;
+    }
+
+    if (!fresh)
+    {
+      // Unreachable goals are cached too, as a path holding only the start
+      c = {goal, map_->terrain_revision(), plan(start, goal), 0};
+      if (c.tiles.empty()) c.tiles.push_back(start);
+    }
+
+    if (c.at + 1 >= c.tiles.size()) return {0, 0};
+    return {c.tiles[c.at + 1].x - start.x, c.tiles[c.at + 1].y - start.y};
+  }
+}
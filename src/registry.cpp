@@ -7,12 +7,54 @@
 //==================================================================================================
 
 #include "registry.hpp"
-#include <algorithm>
+#include <cassert>
+#include <utility>
 
 namespace roguey
 {
+  registry::registry()
+  {
+    positions.on_construct([this](entity_id id) { occupancy.insert(id, positions.at(id), occupant_kind(id)); });
+    positions.on_update([this](entity_id id) { occupancy.move(id, positions.at(id)); });
+    positions.on_destroy([this](entity_id id) { occupancy.remove(id); });
+
+    // Destruction is signaled before removal, so the kind is recomputed without the leaving component
+    stats.on_construct([this](entity_id id) { occupancy.set_kind(id, occupant::Blocker); });
+    stats.on_destroy(
+      [this](entity_id id) { occupancy.set_kind(id, items.contains(id) ? occupant::Pickup : occupant::Other); });
+    items.on_construct([this](entity_id id) { occupancy.set_kind(id, occupant_kind(id)); });
+    items.on_destroy(
+      [this](entity_id id) { occupancy.set_kind(id, stats.contains(id) ? occupant::Blocker : occupant::Other); });
+  }
+
+  occupant registry::occupant_kind(entity_id id) const
+  {
+    return stats.contains(id) ? occupant::Blocker : items.contains(id) ? occupant::Pickup : occupant::Other;
+  }
+
+  entity_id registry::create_entity()
+  {
+    if (free_indices.empty())
+    {
+      generations.push_back(0);
+      return make_entity(static_cast<std::uint32_t>(generations.size() - 1), 0);
+    }
+
+    auto index = free_indices.back();
+    free_indices.pop_back();
+    return make_entity(index, generations[index]);
+  }
+
+  void registry::release(std::uint32_t index)
+  {
+    generations[index]++;
+    free_indices.push_back(index);
+  }
+
   void registry::destroy_entity(entity_id id)
   {
+    if (!alive(id)) return;
+
     positions.erase(id);
     renderables.erase(id);
     stats.erase(id);
@@ -21,9 +63,10 @@ namespace roguey
     script_paths.erase(id);
     projectiles.erase(id);
     monster_types.erase(id);
+    timers.erase(id);
+    pending_destroys.erase(id);
 
-    std::erase(monsters, id);
-    if (id == boss_id) boss_id = 0;
+    release(entity_index(id));
   }
 
   void registry::clear()
@@ -36,9 +79,82 @@ namespace roguey
     names.clear();
     script_paths.clear();
     monster_types.clear();
-    monsters.clear();
+    timers.clear();
+    pending_destroys.clear();
+    occupancy.clear();
 
     boss_id = 0;
-    next_id = 1;
+
+    // Every slot is recycled, lowest indices first, so index ranges stay compact from one level to the next
+    free_indices.clear();
+    for (auto index = static_cast<std::uint32_t>(generations.size() - 1); index > 0; --index) release(index);
+  }
+
+  registry_snapshot registry::take_snapshot() const
+  {
+    assert(pending_destroys.empty());
+
+    return {positions.snapshot(),
+            renderables.snapshot(),
+            stats.snapshot(),
+            items.snapshot(),
+            names.snapshot(),
+            script_paths.snapshot(),
+            monster_types.snapshot(),
+            projectiles.snapshot(),
+            timers.snapshot(),
+            generations,
+            free_indices,
+            occupancy.width(),
+            occupancy.height(),
+            player_id,
+            boss_id};
+  }
+
+  void registry::restore(registry_snapshot const& snapshot)
+  {
+    positions.restore(snapshot.positions);
+    renderables.restore(snapshot.renderables);
+    stats.restore(snapshot.stats);
+    items.restore(snapshot.items);
+    names.restore(snapshot.names);
+    script_paths.restore(snapshot.script_paths);
+    monster_types.restore(snapshot.monster_types);
+    projectiles.restore(snapshot.projectiles);
+    timers.restore(snapshot.timers);
+    pending_destroys.clear();
+
+    generations = snapshot.generations;
+    free_indices = snapshot.free_indices;
+    player_id = snapshot.player_id;
+    boss_id = snapshot.boss_id;
+
+    // The occupancy index is derived data, rebuilding it is a single pass over the positions
+    occupancy.resize(snapshot.width, snapshot.height);
+    for (auto const& [id, p] : std::as_const(positions)) occupancy.insert(id, p, occupant_kind(id));
+  }
+
+  void registry::place(entity_id id, position p)
+  {
+    if (positions.contains(id)) positions.replace(id, p);
+    else positions.emplace(id, p);
+  }
+
+  void registry::defer_destroy(entity_id id)
+  {
+    if (!alive(id) || pending_destroys.contains(id)) return;
+
+    pending_destroys.emplace(id);
+    occupancy.remove(id);
+  }
+
+  void registry::flush()
+  {
+    while (!pending_destroys.empty())
+    {
+      auto id = pending_destroys.ids().back();
+      pending_destroys.erase(id);
+      destroy_entity(id);
+    }
   }
 }
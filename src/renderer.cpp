@@ -12,6 +12,7 @@
 #include <ftxui/dom/elements.hpp>
 #include <ftxui/screen/terminal.hpp>
 #include <iostream>
+#include <map>
 #include <thread>
 
 namespace roguey
@@ -50,9 +51,9 @@ namespace roguey
             style.has_bg = true;
           }
         }
-        style_cache[key] = style;
-        // Expose keys back to Lua for scripts to use (e.g. "ui_gold")
-        lua[key] = key;
+        symbol name{key};
+        if (name.id() >= style_cache.size()) style_cache.resize(name.id() + 1);
+        style_cache[name.id()] = style;
       }
     }
 
@@ -75,10 +76,9 @@ namespace roguey
     }
   }
 
-  Decorator renderer::get_style(std::string const& name) const
+  Decorator renderer::get_style(symbol name) const
   {
-    auto it = style_cache.find(name);
-    if (it != style_cache.end()) { return it->second.decorator(); }
+    if (name.id() < style_cache.size() && style_cache[name.id()]) { return style_cache[name.id()]->decorator(); }
     return color(Color::White);
   }
 
@@ -98,11 +98,9 @@ namespace roguey
   Element renderer::render_dungeon(dungeon const& map,
                                    registry const& reg,
                                    message_log const& log,
-                                   int player_id,
+                                   entity_id player_id,
                                    int depth,
-                                   std::string const& title,
-                                   std::string const& wall_color,
-                                   std::string const& floor_color)
+                                   std::string const& title)
   {
     auto term_size = Terminal::Size();
     int overhead_y = 11;
@@ -115,7 +113,7 @@ namespace roguey
     if (view_h < 5) view_h = 5;
 
     position p = {0, 0};
-    if (reg.positions.count(player_id)) p = reg.positions.at(player_id);
+    if (reg.positions.contains(player_id)) p = reg.positions.at(player_id);
 
     int cam_x = std::clamp(p.x - view_w / 2, 0, std::max(0, map.width - view_w));
     int cam_y = std::clamp(p.y - view_h / 2, 0, std::max(0, map.height - view_h));
@@ -123,12 +121,26 @@ namespace roguey
     last_cam_x = cam_x;
     last_cam_y = cam_y;
 
+    // Resolve entities to screen cells from the occupancy index, only visiting the camera window.
+    // When several entities share a cell, the one in the lowest slot is drawn on top. Slots are compared rather
+    // than ids, whose generation bits would sort a recycled slot after newer ones.
+    grid2D<std::pair<entity_id, renderable const*>> overlay(view_w, view_h, {0, nullptr});
+    reg.occupancy.query({cam_x, cam_y, view_w, view_h}, [&](entity_id id, position ep, occupant) {
+      if (!reg.renderables.contains(id)) return;
+      if (id != player_id && !map.is_visible(ep.x, ep.y)) return;
+
+      auto& cell = overlay(ep.x - cam_x, ep.y - cam_y);
+      if (!cell.second || entity_index(id) < entity_index(cell.first)) cell = {id, &reg.renderables.at(id)};
+    });
+
+    symbol const hidden_color = "ui_hidden";
     Elements grid_rows;
 
     for (int y = 0; y < view_h; ++y)
     {
       Elements row_cells;
       int wy = cam_y + y;
+      auto entities = overlay.row(y);
 
       for (int x = 0; x < view_w; ++x)
       {
@@ -140,36 +152,20 @@ namespace roguey
           continue;
         }
 
-        bool entity_drawn = false;
-        for (auto const& [id, r] : reg.renderables)
+        if (auto const* r = entities[x].second)
         {
-          if (reg.positions.count(id))
-          {
-            position ep = reg.positions.at(id);
-            if (ep.x == wx && ep.y == wy)
-            {
-              if (id == player_id || map.visible_tiles.count({wx, wy}))
-              {
-                std::string g(1, r.glyph);
-                row_cells.push_back(text(g) | get_style(r.color));
-                entity_drawn = true;
-                break;
-              }
-            }
-          }
+          row_cells.push_back(text(std::string(1, r->glyph)) | get_style(r->color));
+          continue;
         }
 
-        if (entity_drawn) continue;
-
-        if (map.visible_tiles.count({wx, wy}))
+        if (map.is_visible(wx, wy))
         {
-          char tile = map.grid(wx, wy);
-          std::string c_key = (tile == '#') ? wall_color : floor_color;
-          row_cells.push_back(text(std::string(1, tile)) | get_style(c_key));
+          auto const& tile = map.tile_at(wx, wy);
+          row_cells.push_back(text(std::string(1, tile.glyph)) | get_style(tile.style));
         }
-        else if (map.explored(wx, wy))
+        else if (map.explored.test(wx, wy))
         {
-          row_cells.push_back(text(std::string(1, map.grid(wx, wy))) | get_style("ui_hidden"));
+          row_cells.push_back(text(std::string(1, map.tile_at(wx, wy).glyph)) | get_style(hidden_color));
         }
         else { row_cells.push_back(text(" ")); }
       }
@@ -196,7 +192,7 @@ namespace roguey
     {
       for (size_t i = 0; i < inventory.size(); ++i)
       {
-        items.push_back(text("[" + std::to_string(i + 1) + "] " + inventory[i].name) | center);
+        items.push_back(text("[" + std::to_string(i + 1) + "] " + inventory[i].name.str()) | center);
       }
     }
 
@@ -206,7 +202,8 @@ namespace roguey
            flex;
   }
 
-  Element renderer::render_stats(registry const& reg, int player_id, std::string player_name, message_log const& log)
+  Element renderer::render_stats(registry const& reg, entity_id player_id, std::string player_name,
+                                 message_log const& log)
   {
     if (!reg.stats.contains(player_id)) return text("Error: No Stats");
 
@@ -214,11 +211,11 @@ namespace roguey
 
     // Determine Speed Label using loaded configuration
     std::string speed_str = "Unknown";
-    std::string speed_color = "ui_default";
+    symbol speed_color = "ui_default";
 
     for (auto const& threshold : speed_thresholds)
     {
-      if (s.action_delay <= threshold.limit)
+      if (reg.timers.delay(player_id) <= threshold.limit)
       {
         speed_str = threshold.label;
         speed_color = threshold.color;
@@ -230,7 +227,7 @@ namespace roguey
              text(" Stats ") | get_style("ui_border"),
              vbox({filler(),
                    vbox({hbox({text("Name:   "), text(player_name) | get_style("ui_emphasis")}) | flex,
-                         hbox({text("Class:  "), text(s.archetype) | get_style("ui_emphasis")}) | flex, text(" "),
+                         hbox({text("Class:  "), text(s.archetype.str()) | get_style("ui_emphasis")}) | flex, text(" "),
 
                          hbox({text("Level:  "), text(std::to_string(s.level)) | get_style("ui_gold")}) | flex,
                          hbox({text("XP:     "), text(std::to_string(s.xp)) | get_style("ui_text")}) | flex, text(" "),
@@ -7,7 +7,9 @@
 //==================================================================================================
 #include "script_engine.hpp"
 #include "systems.hpp"
+#include <algorithm>
 #include <filesystem>
+#include <utility>
 
 namespace roguey
 {
@@ -24,11 +26,13 @@ namespace roguey
 
     // Retrieve list of global options
     discover_assets();
+    expose_style_keys();
 
     // Global log in LUA
     lua.new_usertype<message_log>(
       "Log", "add",
-      sol::overload([](message_log& l, std::string const& msg) { l.add(msg, "ui_default"); }, &message_log::add));
+      sol::overload([](message_log& l, std::string const& msg) { l.add(msg, "ui_default"); },
+                    [](message_log& l, std::string const& msg, std::string const& color) { l.add(msg, color); }));
 
     sol::protected_function start_cfg_func = lua["get_start_config"];
     configuration = start_cfg_func();
@@ -42,9 +46,59 @@ namespace roguey
 
     // Register basic types
     lua.new_usertype<position>("Position", "x", &position::x, "y", &position::y);
-    lua.new_usertype<stats>("Stats", "archetype", &stats::archetype, "hp", &stats::hp, "max_hp", &stats::max_hp, "mana",
-                            &stats::mana, "max_mana", &stats::max_mana, "damage", &stats::damage, "xp", &stats::xp,
-                            "level", &stats::level, "gold", &stats::gold, "fov", &stats::fov_range);
+
+    // Interned fields are exposed to Lua as plain strings
+    auto archetype = sol::property([](stats const& s) { return s.archetype.str(); },
+                                   [](stats& s, std::string const& v) { s.archetype = v; });
+
+    lua.new_usertype<stats>("Stats", "archetype", std::move(archetype), "hp", &stats::hp, "max_hp", &stats::max_hp,
+                            "mana", &stats::mana, "max_mana", &stats::max_mana, "damage", &stats::damage, "xp",
+                            &stats::xp, "level", &stats::level, "gold", &stats::gold, "fov", &stats::fov_range);
+
+    // Paths are searched natively. Passing the caller id lets its path be reused on the next turns.
+    lua.set_function("find_path", [this](int x0, int y0, int x1, int y1, sol::optional<entity_id> requester) {
+      position step = {0, 0};
+      if (paths_ && requester) step = paths_->next_step(*requester, {x0, y0}, {x1, y1});
+      else if (paths_)
+      {
+        auto const& path = paths_->plan({x0, y0}, {x1, y1});
+        if (path.size() > 1) step = {path[1].x - x0, path[1].y - y0};
+      }
+      return std::make_tuple(step.x, step.y);
+    });
+
+    lua.set_function("find_full_path", [this](int x0, int y0, int x1, int y1) {
+      std::vector<position> path;
+      if (paths_) path = paths_->plan({x0, y0}, {x1, y1});
+      return sol::as_table(std::move(path));
+    });
+
+    // Read-only views of plain tables, nested ones included, built once per source table. Lookups go through to
+    // the source so globals added later are seen, # and pairs keep working, writes raise an error.
+    // Tables with a metatable, such as usertypes, are handed out as they are.
+    sol::protected_function read_only = lua.safe_script(R"lua(
+      local views = setmetatable({}, { __mode = "k" })
+      local function view(t)
+        if type(t) ~= "table" or getmetatable(t) ~= nil then return t end
+        local v = views[t]
+        if v then return v end
+        v = setmetatable({}, {
+          __index = function(_, k) return view(t[k]) end,
+          __newindex = function() error("shared tables are read-only", 2) end,
+          __len = function() return #t end,
+          __pairs = function()
+            return function(_, k)
+              local nk, nv = next(t, k)
+              return nk, view(nv)
+            end, v, nil
+          end
+        })
+        views[t] = v
+        return v
+      end
+      return view
+    )lua");
+    shared_globals_ = read_only(lua.globals());
   }
 
   void script_engine::discover_assets()
@@ -58,27 +112,84 @@ namespace roguey
     }
   }
 
+  void script_engine::expose_style_keys()
+  {
+    // Style names are exposed back to Lua for scripts to use (e.g. "ui_gold")
+    sol::table colors = lua["game_colors"];
+    if (!colors.valid()) return;
+
+    for (auto const& [key, val] : colors)
+    {
+      std::string name = key.as<std::string>();
+      lua[name] = name;
+    }
+  }
+
   bool script_engine::load_script(std::string const& path)
   {
     auto res = lua.safe_script_file(systems::checked_script_path(path), sol::script_pass_on_error);
     return res.valid();
   }
 
+  compiled_script const* script_engine::script(symbol path, message_log& log)
+  {
+    if (auto it = compiled_.find(path); it != compiled_.end()) return it->second ? &*it->second : nullptr;
+    auto& slot = compiled_[path];
+
+    auto fail = [&](sol::error const& err) -> compiled_script const* {
+      log.add("Script Error (" + fs::path(path.str()).filename().string() + "): " + std::string(err.what()),
+              "ui_failure");
+      return nullptr;
+    };
+
+    sol::load_result chunk = lua.load_file(systems::checked_script_path(path.str()));
+    if (!chunk.valid()) return fail(chunk.get<sol::error>());
+
+    // Missing names fall back to the read-only view of the shared globals, new ones land in the environment.
+    // _G is shadowed too, so a script can't reach the shared table to write through it.
+    sol::environment env(lua, sol::create, shared_globals_);
+    env["_G"] = env;
+
+    sol::protected_function run = chunk;
+    sol::set_environment(env, run);
+    auto ran = run();
+    if (!ran.valid()) return fail(ran.get<sol::error>());
+
+    auto own = [&](char const* name) { return env.raw_get<sol::object>(name); };
+    slot = compiled_script{env,
+                           own("update_ai"),
+                           own("update_projectile"),
+                           own("get_init_stats"),
+                           own("level_up"),
+                           own("on_pick"),
+                           own("on_use"),
+                           own("get_level_config"),
+                           own("get_next_level"),
+                           own("get_spawn_odds"),
+                           own("get_loot_odds"),
+                           own("get_boss_script"),
+                           own("item_data"),
+                           own("spell_data")};
+    return &*slot;
+  }
+
   std::string script_engine::pick_from_weights(sol::table weights, std::mt19937& gen)
   {
-    int total_weight = 0;
     std::vector<std::pair<std::string, int>> pool;
-    for (auto const& [key, val] : weights)
-    {
-      int w = val.as<int>();
-      total_weight += w;
-      pool.push_back({key.as<std::string>(), total_weight});
-    }
+    for (auto const& [key, val] : weights) pool.push_back({key.as<std::string>(), val.as<int>()});
+
+    // Lua leaves the order of pairs unspecified, sorting keeps a seed drawing the same scripts
+    std::sort(pool.begin(), pool.end());
+
+    int total_weight = 0;
+    for (auto const& p : pool) total_weight += p.second;
     if (total_weight <= 0) return "";
+
     int roll = std::uniform_int_distribution<>(1, total_weight)(gen);
-    for (auto const& p : pool)
+    for (auto const& [key, weight] : pool)
     {
-      if (roll <= p.second) return p.first;
+      if (roll <= weight) return key;
+      roll -= weight;
     }
     return "";
   }
@@ -28,22 +28,19 @@ namespace roguey
     {
       return g.renderer.render_game_over(g.log);
     }
-    if (g.reg.boss_id != 0 && !g.reg.positions.contains(g.reg.boss_id)) { return g.renderer.render_victory(g.log); }
+    if (g.reg.boss_id != 0 && !g.reg.alive(g.reg.boss_id)) { return g.renderer.render_victory(g.log); }
 
-    sol::table config = g.scripts.lua["get_level_config"](g.depth);
+    sol::table config = g.level_hooks->get_level_config(g.depth);
     std::string level_name = config["name"].get_or<std::string>("Unknown");
-    std::string wall_color = config["wall_color"].get_or<std::string>("asset_wall");
-    std::string floor_color = config["floor_color"].get_or<std::string>("asset_floor");
 
-    return g.renderer.render_dungeon(g.map, g.reg, g.log, g.reg.player_id, g.depth, level_name, wall_color,
-                                     floor_color);
+    return g.renderer.render_dungeon(g.map, g.reg, g.log, g.reg.player_id, g.depth, level_name);
   }
 
   bool dungeon_state::on_event(game& g, ftxui::Event event)
   {
     ftxui::Event active_event = event;
 
-    if (g.has_buffered_event && g.reg.stats[g.reg.player_id].action_timer == 0)
+    if (g.has_buffered_event && g.reg.timers.expired(g.reg.player_id))
     {
       if (event.is_character() || is_movement(event))
       {
@@ -65,16 +62,18 @@ namespace roguey
       g.set_state(game_over_state{});
       return true;
     }
-    if (g.reg.boss_id != 0 && !g.reg.positions.contains(g.reg.boss_id))
+    if (g.reg.boss_id != 0 && !g.reg.alive(g.reg.boss_id))
     {
       g.set_state(victory_state{});
       return true;
     }
 
     // Optimization: Only redraw on tick IF projectiles moved
+    // Projectiles keep flying while the game waits for the player, every other timer stays paused
     if (active_event == ftxui::Event::Special({0}))
     {
-      return systems::update_projectiles(g.reg, g.map, g.log, g.scripts.lua);
+      g.reg.timers.countdown_of(g.reg.projectiles.ids());
+      return systems::update_projectiles(g.reg, g.map, g.log, g.scripts);
     }
 
     if (active_event == ftxui::Event::Character('q') || active_event == ftxui::Event::Character('Q'))
@@ -101,7 +100,7 @@ namespace roguey
       return true;
     }
 
-    if (g.reg.stats[g.reg.player_id].action_timer > 0)
+    if (!g.reg.timers.expired(g.reg.player_id))
     {
       if (active_event.is_character() || is_movement(active_event))
       {
@@ -136,55 +135,53 @@ namespace roguey
     }
     else if (active_event == ftxui::Event::Character('f'))
     {
-      systems::cast_fireball(g.reg, g.map, g.last_dx, g.last_dy, g.log, g.scripts.lua);
+      systems::cast_fireball(g.reg, g.map, g.last_dx, g.last_dy, g.log, g.scripts);
       acted = true;
     }
 
     if (acted)
     {
-      auto& s = g.reg.stats[g.reg.player_id];
-      s.action_timer = s.action_delay;
+      g.reg.timers.rearm(g.reg.player_id);
 
       if (dx != 0 || dy != 0)
       {
         g.last_dx = dx;
         g.last_dy = dy;
 
-        position& p = g.reg.positions[g.reg.player_id];
+        position p = g.reg.positions.at(g.reg.player_id);
         entity_id target = systems::get_entity_at(g.reg, p.x + dx, p.y + dy);
 
         if (target && g.reg.stats.contains(target))
         {
-          systems::attack(g.reg, g.reg.player_id, target, g.log, g.scripts.lua);
+          systems::attack(g.reg, g.reg.player_id, target, g.log, g.scripts);
         }
         else if (g.map.is_walkable(p.x + dx, p.y + dy))
         {
-          p.x += dx;
-          p.y += dy;
+          g.reg.place(g.reg.player_id, {p.x + dx, p.y + dy});
           if (target && g.reg.items.contains(target))
           {
             if (g.reg.items[target].type == item_type::Stairs)
             {
-              std::string next_lvl = g.reg.items[target].name;
+              std::string next_lvl = g.reg.items[target].name.str();
               g.reset(false, next_lvl);
               g.set_state(dungeon_state{});
               return true;
             }
 
-            if (systems::execute_script(g.scripts.lua, g.reg.items[target].script, g.log))
+            if (auto const* script = g.scripts.script(g.reg.items[target].script, g.log))
             {
-              if (g.scripts.lua["on_pick"](g.reg.stats[g.reg.player_id], g.log))
-              {
-                g.inventory.push_back(g.reg.items[target]);
-              }
+              auto picked = script->on_pick(g.reg.stats[g.reg.player_id], g.log);
+              if (picked.valid() && picked.get<bool>()) { g.inventory.push_back(g.reg.items[target]); }
             }
-            g.reg.destroy_entity(target);
+            g.reg.defer_destroy(target);
           }
         }
       }
 
-      g.map.update_fov(g.reg.positions[g.reg.player_id].x, g.reg.positions[g.reg.player_id].y,
+      g.stream_level();
+      g.map.update_fov(g.reg.positions.at(g.reg.player_id).x, g.reg.positions.at(g.reg.player_id).y,
                        g.reg.stats[g.reg.player_id].fov_range);
+      g.map.update_flow(g.reg.positions.at(g.reg.player_id));
 
       g.set_state(tick_state{});
     }
@@ -36,10 +36,9 @@ namespace roguey
         if (idx < g.inventory.size())
         {
           auto& item = g.inventory[idx];
-          if (systems::execute_script(g.scripts.lua, item.script, g.log))
+          if (auto const* script = g.scripts.script(item.script, g.log))
           {
-            sol::protected_function on_use = g.scripts.lua["on_use"];
-            auto use_res = on_use(g.reg.stats[g.reg.player_id], g.log);
+            auto use_res = script->on_use(g.reg.stats[g.reg.player_id], g.log);
 
             if (use_res.valid())
             {
@@ -47,10 +46,9 @@ namespace roguey
               g.inventory.erase(g.inventory.begin() + idx);
 
               // Apply Turn Cost
-              if (g.reg.stats.contains(g.reg.player_id))
+              if (g.reg.timers.contains(g.reg.player_id))
               {
-                auto& s = g.reg.stats[g.reg.player_id];
-                s.action_timer = s.action_delay; // Using item takes one turn
+                g.reg.timers.rearm(g.reg.player_id); // Using item takes one turn
               }
 
               // Transition to Animating State to process the turn
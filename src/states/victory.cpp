@@ -20,8 +20,8 @@ namespace roguey
   {
     if (event == ftxui::Event::Character('c') || event == ftxui::Event::Character('C'))
     {
-      g.scripts.load_script(g.current_level_script);
-      g.reset(false, g.scripts.lua["get_next_level"](g.depth));
+      std::string next_level = g.level_hooks->get_next_level(g.depth);
+      g.reset(false, next_level);
       g.set_state(dungeon_state{});
     }
     if (event == ftxui::Event::Character('q') || event == ftxui::Event::Character('Q')) { g.stop(); }
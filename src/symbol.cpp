@@ -0,0 +1,70 @@
+//==================================================================================================
+/*
+  Roguey
+  Copyright : Joel FALCOU
+  SPDX-License-Identifier: MIT
+*/
+//==================================================================================================
+#include "types/symbol.hpp"
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace roguey
+{
+  namespace
+  {
+    // Strings live in a deque so references handed out by str() stay valid as the table grows.
+    // Levels are prepared on a worker thread, so lookups share the lock and only new strings take it exclusively.
+    struct interner
+    {
+      std::shared_mutex mutex;
+      std::deque<std::string> strings = {""};
+      std::unordered_map<std::string_view, std::uint32_t> ids = {{strings.front(), 0}};
+    };
+
+    interner& table()
+    {
+      static interner instance;
+      return instance;
+    }
+  }
+
+  symbol::symbol(std::string_view s)
+  {
+    auto& t = table();
+    {
+      std::shared_lock lock(t.mutex);
+      if (auto it = t.ids.find(s); it != t.ids.end())
+      {
+        id_ = it->second;
+        return;
+      }
+    }
+
+    std::unique_lock lock(t.mutex);
+    if (auto it = t.ids.find(s); it != t.ids.end())
+    {
+      id_ = it->second;
+      return;
+    }
+
+    id_ = static_cast<std::uint32_t>(t.strings.size());
+    t.ids.emplace(t.strings.emplace_back(s), id_);
+  }
+
+  std::string const& symbol::str() const
+  {
+    auto& t = table();
+    std::shared_lock lock(t.mutex);
+    return t.strings[id_];
+  }
+
+  std::size_t symbol::count()
+  {
+    auto& t = table();
+    std::shared_lock lock(t.mutex);
+    return t.strings.size();
+  }
+}
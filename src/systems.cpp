@@ -6,6 +6,7 @@
 */
 //==================================================================================================
 #include "renderer.hpp"
+#include "script_engine.hpp"
 #include "systems.hpp"
 #include <algorithm>
 #include <cmath>
@@ -24,22 +25,8 @@ namespace roguey
       return complete_path.string();
     }
 
-    bool execute_script(sol::state& lua, std::string const& path, message_log& log)
+    std::optional<sol::table> try_get_table(sol::table const& t, std::string const& name, message_log& log)
     {
-      auto res = lua.safe_script_file(checked_script_path(path), sol::script_pass_on_error);
-      if (!res.valid())
-      {
-        sol::error err = res;
-        namespace fs = std::filesystem;
-        log.add("Script Error (" + fs::path(path).filename().string() + "): " + std::string(err.what()), "ui_failure");
-        return false;
-      }
-      return true;
-    }
-
-    std::optional<sol::table> try_get_table(sol::state& lua, std::string const& name, message_log& log)
-    {
-      sol::table t = lua[name];
       if (!t.valid())
       {
         log.add("Lua Error: Table '" + name + "' not found.", "ui_failure");
@@ -63,8 +50,7 @@ namespace roguey
       cfg.stats.level = 1;
       cfg.stats.fov_range = t.get_or("fov", 8);
       cfg.stats.gold = 0;
-      cfg.stats.action_delay = t.get_or("delay", 10);
-      cfg.stats.action_timer = 0;
+      cfg.delay = t.get_or("delay", 10);
 
       // Renderable Extraction
       std::string glyph_str = t.get_or<std::string>("glyph", "?");
@@ -73,41 +59,73 @@ namespace roguey
 
       // Meta
       cfg.name = t.get_or("name", std::string(default_name));
-      cfg.type = t.get_or("type", std::string("entity"));
+      cfg.type = t.get_or<std::string>("type", "entity");
 
       return cfg;
     }
+
+    item_data parse_item_config(sol::table const& t)
+    {
+      item_data data;
+
+      std::string glyph_str = t.get_or<std::string>("glyph", "?");
+      data.render.glyph = glyph_str.empty() ? '?' : glyph_str[0];
+      data.render.color = t.get_or<std::string>("color", "item_gold");
+
+      std::string kind = t.get_or<std::string>("kind", "consumable");
+      data.kind = kind == "gold" ? item_type::Gold : item_type::Consumable;
+      data.name = t.get_or<std::string>("name", "Unknown");
+
+      return data;
+    }
+
+    tile_registry parse_tile_config(sol::table const& level_config)
+    {
+      // Levels without a tiles table keep the classic walls and floors in their configured colors
+      auto types = dungeon::default_tiles(level_config.get_or<std::string>("wall_color", "asset_wall"),
+                                          level_config.get_or<std::string>("floor_color", "asset_floor"));
+
+      sol::optional<sol::table> tiles = level_config["tiles"];
+      if (!tiles) return types;
+
+      for (auto const& [key, value] : *tiles)
+      {
+        if (!key.is<std::string>() || !value.is<sol::table>()) continue;
+        sol::table t = value;
+
+        std::string glyph_str = t.get_or<std::string>("glyph", "?");
+        std::uint8_t flags = 0;
+        if (t.get_or("walkable", false)) flags |= Walkable;
+        if (t.get_or("opaque", false)) flags |= Opaque;
+        if (t.get_or("explorable", true)) flags |= Explorable;
+        if (t.get_or("damaging", false)) flags |= Damaging;
+
+        types.add({key.as<std::string>(), glyph_str.empty() ? '?' : glyph_str[0],
+                   t.get_or<std::string>("color", "ui_default"), flags});
+      }
+      return types;
+    }
   }
 
-  void message_log::add(std::string msg, std::string const& color)
+  void message_log::add(std::string msg, symbol color)
   {
-    messages.push_back({msg, color});
+    messages.push_back({std::move(msg), color});
     if (messages.size() > max_messages) messages.erase(messages.begin());
   }
 
   entity_id systems::get_entity_at(registry const& reg, int x, int y, entity_id ignore_id)
   {
-    entity_id found = 0;
-    for (auto const& [id, pos] : reg.positions)
-    {
-      if (id == ignore_id) continue;
-      if (pos.x == x && pos.y == y)
-      {
-        if (reg.stats.contains(id)) return id;
-        found = id;
-      }
-    }
-    return found;
+    return reg.occupancy.at(x, y, ignore_id);
   }
 
-  void systems::attack(registry& reg, entity_id a_id, entity_id d_id, message_log& log, sol::state& lua)
+  void systems::attack(registry& reg, entity_id a_id, entity_id d_id, message_log& log, script_engine& scripts)
   {
     auto& a = reg.stats[a_id];
     auto& d = reg.stats[d_id];
     d.hp -= a.damage;
 
-    std::string a_name = reg.names.count(a_id) ? reg.names.at(a_id) : "Unknown";
-    std::string d_name = reg.names.count(d_id) ? reg.names.at(d_id) : "Unknown";
+    std::string a_name = reg.names.contains(a_id) ? reg.names.at(a_id).str() : "Unknown";
+    std::string d_name = reg.names.contains(d_id) ? reg.names.at(d_id).str() : "Unknown";
 
     if (a_id == reg.player_id) { log.add("You hit the " + d_name + " for " + std::to_string(a.damage), "ui_default"); }
     else if (d_id == reg.player_id)
@@ -121,14 +139,14 @@ namespace roguey
       {
         log.add("You defeated the " + d_name + "! +50 XP", "ui_gold");
         reg.stats[a_id].xp += 50;
-        check_level_up(reg, log, lua);
+        check_level_up(reg, log, scripts);
       }
       else if (d_id == reg.player_id) { log.add(d_name + " was defeated by the " + a_name, "ui_emphasis"); }
-      reg.destroy_entity(d_id);
+      reg.defer_destroy(d_id);
     }
   }
 
-  void systems::check_level_up(registry& reg, message_log& log, sol::state& lua)
+  void systems::check_level_up(registry& reg, message_log& log, script_engine& scripts)
   {
     auto& s = reg.stats[reg.player_id];
     int next_lvl_xp = s.level * 100;
@@ -136,16 +154,16 @@ namespace roguey
     if (s.xp >= next_lvl_xp)
     {
       s.level++;
-      if (!execute_script(lua, reg.player_class_script, log)) return;
+      auto const* script = scripts.script(reg.player_class_script, log);
+      if (!script) return;
 
-      sol::table current_stats = lua.create_table();
+      sol::table current_stats = scripts.lua.create_table();
       current_stats["hp"] = s.max_hp;
       current_stats["mp"] = s.max_mana;
       current_stats["damage"] = s.damage;
-      current_stats["delay"] = s.action_delay;
+      current_stats["delay"] = reg.timers.delay(reg.player_id);
 
-      sol::protected_function level_func = lua["level_up"];
-      auto level_res = level_func(current_stats);
+      auto level_res = script->level_up(current_stats);
 
       if (level_res.valid())
       {
@@ -161,21 +179,21 @@ namespace roguey
         s.max_mana = cfg.stats.max_mana;
         s.mana = s.max_mana;
         s.damage = cfg.stats.damage;
-        s.action_delay = cfg.stats.action_delay;
+        reg.timers.set_delay(reg.player_id, cfg.delay);
 
         log.add("Level Up! You are now Level " + std::to_string(s.level), "ui_gold");
       }
     }
   }
 
-  void systems::cast_fireball(registry& reg, dungeon& map, int dx, int dy, message_log& log, sol::state& lua)
+  void systems::cast_fireball(registry& reg, dungeon& map, int dx, int dy, message_log& log, script_engine& scripts)
   {
-    std::string script_path = "scripts/spells/fireball.lua";
+    symbol script_path = "scripts/spells/fireball.lua";
 
-    if (!execute_script(lua, script_path, log)) return;
+    auto const* script = scripts.script(script_path, log);
+    if (!script) return;
 
-    // Use Helper
-    auto data_opt = try_get_table(lua, "spell_data", log);
+    auto data_opt = try_get_table(script->spell_data, "spell_data", log);
     if (!data_opt) return;
     sol::table data = *data_opt;
 
@@ -186,7 +204,7 @@ namespace roguey
 
     std::string glyph_str = data.get_or<std::string>("glyph", "*");
     char glyph = glyph_str.empty() ? '*' : glyph_str[0];
-    std::string color = data.get_or<std::string>("color", "ui_default");
+    symbol color = data.get_or<std::string>("color", "ui_default");
     std::string name = data.get_or<std::string>("name", "Spell");
 
     auto& s = reg.stats[reg.player_id];
@@ -197,7 +215,7 @@ namespace roguey
     }
     s.mana -= mana_cost;
 
-    position p = reg.positions[reg.player_id];
+    position p = reg.positions.at(reg.player_id);
     int start_x = p.x + dx;
     int start_y = p.y + dy;
 
@@ -208,158 +226,142 @@ namespace roguey
     }
 
     entity_id id = reg.create_entity();
-    reg.positions[id] = p;
     reg.renderables[id] = {glyph, color};
-    reg.projectiles[id] = {dx, dy, damage, range, reg.player_id, delay, 0};
+    reg.projectiles[id] = {dx, dy, damage, range, reg.player_id};
+    reg.timers.emplace(id, delay);
     reg.script_paths[id] = script_path;
     reg.names[id] = name;
+    reg.place(id, p);
 
     log.add("You cast a " + name + "!", color);
   }
 
-  bool systems::update_projectiles(registry& reg, dungeon const& map, message_log& log, sol::state& lua)
+  bool systems::update_projectiles(registry& reg, dungeon const& map, message_log& log, script_engine& scripts)
   {
-    std::vector<entity_id> to_destroy;
     bool any_change = false;
 
-    for (auto& [id, proj] : reg.projectiles)
-    {
-      if (!reg.positions.contains(id))
-      {
-        to_destroy.push_back(id);
-        continue;
-      }
-
-      if (proj.range < 0)
-      {
-        to_destroy.push_back(id);
-        any_change = true;
-        continue;
-      }
-
-      if (proj.action_timer > 0)
-      {
-        proj.action_timer--;
-        continue;
-      }
+    view(reg.projectiles).exclude(reg.positions).each([&](entity_id id, projectile&) { reg.defer_destroy(id); });
 
-      proj.action_timer = proj.action_delay;
+    // Projectiles that hit something on the previous tick are removed now, so the impact stays on screen for a frame
+    view(reg.projectiles).each([&](entity_id id, projectile& proj) {
+      if (proj.range >= 0) return;
+      reg.defer_destroy(id);
       any_change = true;
+    });
 
-      if (proj.range == 0)
-      {
-        log.add(reg.names[id] + " fizzles out.", "ui_default");
-        to_destroy.push_back(id);
-        continue;
-      }
-      proj.range--;
+    // Only projectiles whose timer expired on this tick move
+    view(reg.projectiles, reg.positions)
+      .exclude(reg.pending_destroys)
+      .each_of(reg.timers.ready(), [&](entity_id id, projectile& proj, position pos) {
+        reg.timers.rearm(id);
+        any_change = true;
 
-      auto& pos = reg.positions[id];
+        if (proj.range == 0)
+        {
+          log.add(reg.names[id].str() + " fizzles out.", "ui_default");
+          reg.defer_destroy(id);
+          return;
+        }
+        proj.range--;
 
-      if (reg.script_paths.contains(id))
-      {
-        auto script_res = lua.safe_script_file(reg.script_paths[id], sol::script_pass_on_error);
-        if (script_res.valid())
+        if (reg.script_paths.contains(id))
         {
-          sol::protected_function update_func = lua["update_projectile"];
-          auto res = update_func(pos.x, pos.y, proj.dx, proj.dy);
-          if (res.valid())
+          if (auto const* script = scripts.script(reg.script_paths[id], log))
           {
-            proj.dx = res[0];
-            proj.dy = res[1];
+            auto res = script->update_projectile(pos.x, pos.y, proj.dx, proj.dy);
+            if (res.valid())
+            {
+              proj.dx = res[0];
+              proj.dy = res[1];
+            }
           }
         }
-      }
 
-      int tx = pos.x + proj.dx;
-      int ty = pos.y + proj.dy;
+        int tx = pos.x + proj.dx;
+        int ty = pos.y + proj.dy;
 
-      if (!map.is_walkable(tx, ty))
-      {
-        log.add(reg.names[id] + " hits a wall.", "ui_default");
-        pos.x = tx;
-        pos.y = ty;
-        proj.range = -1;
-        continue;
-      }
+        if (!map.is_walkable(tx, ty))
+        {
+          log.add(reg.names[id].str() + " hits a wall.", "ui_default");
+          reg.place(id, {tx, ty});
+          proj.range = -1;
+          return;
+        }
 
-      entity_id target = get_entity_at(reg, tx, ty, id);
-      if (target != 0 && target != proj.owner)
-      {
-        if (reg.stats.contains(target))
+        entity_id target = get_entity_at(reg, tx, ty, id);
+        if (target != 0 && target != proj.owner)
         {
-          reg.stats[target].hp -= proj.damage;
-          std::string t_name = reg.names.count(target) ? reg.names.at(target) : "Target";
-          log.add(reg.names[id] + " burns " + t_name + " for " + std::to_string(proj.damage), "fx_fire");
+          reg.place(id, {tx, ty});
+          proj.range = -1;
 
-          if (reg.stats[target].hp <= 0)
+          if (reg.stats.contains(target))
           {
-            log.add(t_name + " incinerated.", "ui_gold");
-            reg.destroy_entity(target);
+            reg.stats[target].hp -= proj.damage;
+            std::string t_name = reg.names.contains(target) ? reg.names.at(target).str() : "Target";
+            log.add(reg.names[id].str() + " burns " + t_name + " for " + std::to_string(proj.damage), "fx_fire");
+
+            if (reg.stats[target].hp <= 0)
+            {
+              log.add(t_name + " incinerated.", "ui_gold");
+              reg.defer_destroy(target);
+            }
           }
+          return;
         }
-        pos.x = tx;
-        pos.y = ty;
-        proj.range = -1;
-        continue;
-      }
 
-      pos.x = tx;
-      pos.y = ty;
-    }
+        reg.place(id, {tx, ty});
+      });
 
-    for (auto id : to_destroy) reg.destroy_entity(id);
     return any_change;
   }
 
-  bool systems::move_monsters(registry& reg, dungeon const& map, message_log& log, sol::state& lua)
+  bool systems::move_monsters(registry& reg, dungeon const& map, message_log& log, script_engine& scripts)
   {
     if (!reg.positions.contains(reg.player_id)) return false;
     position p_pos = reg.positions.at(reg.player_id);
     bool any_change = false;
 
-    for (auto m_id : reg.monsters)
-    {
-      if (!reg.positions.contains(m_id) || !reg.script_paths.contains(m_id)) continue;
+    // Monsters are the scripted entities with stats; projectiles have a script but no stats
+    // Only monsters whose timer expired on this tick are handed to their AI script
+    auto monsters = view(reg.stats, reg.script_paths, reg.positions).exclude(reg.pending_destroys);
 
-      auto& m_stats = reg.stats[m_id];
-      if (m_stats.action_timer > 0)
-      {
-        m_stats.action_timer--;
-        continue;
-      }
+    // Whether each of them sees the player is asked in one batch first. Acting never adds or removes another
+    // monster, so the second pass visits them in the same order, and only moves the one acting.
+    std::vector<sight_line> lines;
+    monsters.each_of(reg.timers.ready(),
+                     [&](entity_id, stats&, symbol, position m_pos) { lines.push_back({m_pos, p_pos}); });
+    auto clear = map.lines_of_sight(lines);
+    std::size_t next = 0;
 
-      m_stats.action_timer = m_stats.action_delay;
+    monsters.each_of(reg.timers.ready(), [&](entity_id m_id, stats& s, symbol script, position m_pos) {
+      reg.timers.rearm(m_id);
+      int rx = m_pos.x - p_pos.x, ry = m_pos.y - p_pos.y;
+      bool can_see = clear[next++] && rx * rx + ry * ry < s.fov_range * s.fov_range;
 
-      auto& m_pos = reg.positions[m_id];
-      std::string const& script = reg.script_paths[m_id];
+      auto const* ai = scripts.script(script, log);
+      if (!ai) return true;
 
-      auto script_res = lua.safe_script_file(systems::checked_script_path(script), sol::script_pass_on_error);
-      if (!script_res.valid()) continue;
+      auto res = ai->update_ai(m_pos.x, m_pos.y, p_pos.x, p_pos.y, m_id, can_see);
+      if (!res.valid()) return true;
 
-      sol::protected_function ai_func = lua["update_ai"];
-      auto res = ai_func(m_pos.x, m_pos.y, p_pos.x, p_pos.y);
+      int dx = res[0], dy = res[1];
+      if (dx == 0 && dy == 0) return true;
 
-      if (res.valid())
+      int tx = m_pos.x + dx, ty = m_pos.y + dy;
+      if (tx == p_pos.x && ty == p_pos.y)
       {
-        int dx = res[0], dy = res[1];
-        if (dx != 0 || dy != 0)
-        {
-          int tx = m_pos.x + dx, ty = m_pos.y + dy;
-          if (tx == p_pos.x && ty == p_pos.y)
-          {
-            attack(reg, m_id, reg.player_id, log, lua);
-            any_change = true;
-          }
-          else if (map.is_walkable(tx, ty) && get_entity_at(reg, tx, ty) == 0)
-          {
-            m_pos.x = tx;
-            m_pos.y = ty;
-            any_change = true;
-          }
-        }
+        attack(reg, m_id, reg.player_id, log, scripts);
+        any_change = true;
       }
-    }
+      else if (map.is_walkable(tx, ty) && get_entity_at(reg, tx, ty) == 0)
+      {
+        reg.place(m_id, {tx, ty});
+        any_change = true;
+      }
+
+      // Once the player is dead there is nothing left to chase
+      return !reg.is_pending_destroy(reg.player_id);
+    });
     return any_change;
   }
 }